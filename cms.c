@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cms.h"
+#include "mylib.h"
+
+/**
+ * A Count-Min Sketch, a fixed size table of counters that gives an upper
+ * bound on how many times any string has been inserted.
+ * width is the number of counters in each row, always a power of two.
+ * depth is the number of rows, each using a different hash.
+ * *counters stores depth rows of width counters one after another.
+ */
+struct cmsrec{
+    int width;
+    int depth;
+    unsigned int *counters;
+};
+
+/**
+ * Creates a new sketch with every counter set to 0.
+ * @param width the least number of counters in each row, rounded up to a
+ * power of two.  More counters give tighter estimates.
+ * @param depth the number of rows.  More rows make a bad estimate less
+ * likely.
+ * @return the created sketch.
+ */
+cms cms_new(int width, int depth){
+    int i;
+    cms c = emalloc(sizeof *c);
+    c->width = 1;
+    while(c->width < width){
+        c->width *= 2;
+    }
+    c->depth = depth;
+    c->counters = emalloc(c->width * c->depth * sizeof c->counters[0]);
+    for(i = 0; i < c->width * c->depth; i++){
+        c->counters[i] = 0;
+    }
+    return c;
+}
+
+/**
+ * Frees all memory allocated to the sketch.
+ * @param c the sketch to be freed.
+ */
+void cms_free(cms c){
+    free(c->counters);
+    free(c);
+}
+
+/**
+ * Hashes a string twice, the row hashes are made by combining the two.
+ * @param str the string to be hashed.
+ * @param h1 set to the first hash.
+ * @param h2 set to the second hash, always odd.
+ */
+static void cms_hash(char *str, unsigned int *h1, unsigned int *h2){
+    unsigned int b = 0;
+    *h1 = fnv_hash(str);
+    while(*str != '\0'){
+        b = WORD_HASH(b, (unsigned char)*str++);
+    }
+    b ^= b >> 16;
+    b *= 0x45d9f3bu;
+    b ^= b >> 16;
+    *h2 = b | 1;
+}
+
+/**
+ * Finds the counter a string hashes to in one row.
+ * @param c the sketch.
+ * @param row the row of the counter.
+ * @param h1 the first hash of the string.
+ * @param h2 the second hash of the string.
+ * @return a pointer to the counter.
+ */
+static unsigned int *cms_counter(cms c, int row, unsigned int h1,
+                                 unsigned int h2){
+    return &c->counters[row * c->width + ((h1 + row * h2) & (c->width - 1))];
+}
+
+/**
+ * Counts one more occurrence of a string.  Only the counters holding the
+ * current estimate are raised (conservative update), which keeps the other
+ * rows from drifting further above the true count.
+ * @param c the sketch.
+ * @param str the string that was seen.
+ * @return the new estimate of how many times str has been seen.
+ */
+unsigned int cms_insert(cms c, char *str){
+    unsigned int h1, h2, *counter;
+    unsigned int estimate = 0;
+    int i;
+    cms_hash(str, &h1, &h2);
+    for(i = 0; i < c->depth; i++){
+        counter = cms_counter(c, i, h1, h2);
+        if(i == 0 || *counter < estimate){
+            estimate = *counter;
+        }
+    }
+    estimate++;
+    for(i = 0; i < c->depth; i++){
+        counter = cms_counter(c, i, h1, h2);
+        if(*counter < estimate){
+            *counter = estimate;
+        }
+    }
+    return estimate;
+}
+
+/**
+ * Estimates how many times a string has been inserted.  The estimate is
+ * never less than the true count.
+ * @param c the sketch.
+ * @param str the string to look up.
+ * @return the smallest of the string's counters.
+ */
+unsigned int cms_estimate(cms c, char *str){
+    unsigned int h1, h2, value;
+    unsigned int estimate = 0;
+    int i;
+    cms_hash(str, &h1, &h2);
+    for(i = 0; i < c->depth; i++){
+        value = *cms_counter(c, i, h1, h2);
+        if(i == 0 || value < estimate){
+            estimate = value;
+        }
+    }
+    return estimate;
+}
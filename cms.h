@@ -0,0 +1,11 @@
+#ifndef CMS_H_
+#define CMS_H_
+
+typedef struct cmsrec *cms;
+
+extern unsigned int cms_estimate(cms c, char *str);
+extern void         cms_free(cms c);
+extern unsigned int cms_insert(cms c, char *str);
+extern cms          cms_new(int width, int depth);
+
+#endif
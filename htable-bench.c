@@ -0,0 +1,170 @@
+#define _GNU_SOURCE /* for syscall */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "mylib.h"
+#include "htable.h"
+
+/**
+ * Prints a help notice.
+ */
+static void help_notice(){
+    fprintf(stderr,"%s",
+            "Usage: ./htable-bench [KEYS] [LOOKUPS]\n\n"
+
+            "Fill a hash table with KEYS distinct keys (default 4000000),\n"
+            "then time LOOKUPS random searches (default 4000000), once\n"
+            "with the table on ordinary pages and once on huge pages.\n"
+            "dTLB load misses are shown where perf events are allowed.\n");
+}
+
+/**
+ * Opens a counter of data TLB read misses for this process.
+ * @return the counter, or -1 if perf events are unavailable.
+ */
+static int tlb_counter_open(){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Finds if a number is prime.
+ * @param n the number to be tested.
+ * @return true if prime false if not.
+ */
+static int is_prime(int n){
+    int i;
+    if(n < 2){
+        return 0;
+    }
+    for(i = 2; i <= n / i; i++){
+        if(n % i == 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Writes the key numbered i, spreading consecutive numbers over the
+ * whole range of keys.
+ * @param buf where the key is written, at least 9 characters.
+ * @param i the number of the key.
+ */
+static void make_key(char *buf, unsigned int i){
+    sprintf(buf, "%08x", i * 2654435761u);
+}
+
+/**
+ * Fills a table and times random searches of it.
+ * @param huge true to back the table with huge pages.
+ * @param keys the number of keys to insert.
+ * @param lookups the words to search for, 9 characters apart.
+ * @param num_lookups the number of words to search for.
+ */
+static void run(int huge, int keys, char *lookups, int num_lookups){
+    char word[16];
+    htable h;
+    clock_t start, end;
+    uint64_t misses = 0;
+    int have_misses = 0;
+    long found = 0;
+    int capacity = keys + keys / 4;
+    int counter, i;
+
+    while(!is_prime(capacity)){
+        capacity++;
+    }
+    h = huge ? htable_new_huge(capacity, LINEAR_P)
+        : htable_new(capacity, LINEAR_P);
+    for(i = 0; i < keys; i++){
+        make_key(word, i);
+        htable_insert(h, word);
+    }
+
+    counter = tlb_counter_open();
+    if(counter >= 0){
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    start = clock();
+    for(i = 0; i < num_lookups; i++){
+        found += htable_search(h, lookups + 9 * i);
+    }
+    end = clock();
+    if(counter >= 0){
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        have_misses = read(counter, &misses, sizeof misses) == sizeof misses;
+        close(counter);
+    }
+
+    printf("%-12s %10.3f", huge ? "huge pages" : "base pages",
+           (end - start) / (double)CLOCKS_PER_SEC);
+    if(have_misses){
+        printf(" %14lu", (unsigned long)misses);
+    }else{
+        printf(" %14s", "n/a");
+    }
+    printf(" %10ld\n", found);
+    htable_free(h);
+}
+
+/**
+ * Benchmarks random searches of a large table with and without huge
+ * pages.
+ * @param argc the number of arguments.
+ * @param argv the string of arguments.
+ * @return an exit-success notifier.
+ */
+int main(int argc, char **argv){
+    int keys = 4000000;
+    int num_lookups = 4000000;
+    char *lookups;
+    int i;
+
+    if(argc > 1 && strcmp(argv[1], "-h") == 0){
+        help_notice();
+        return EXIT_SUCCESS;
+    }
+    if(argc > 1){
+        keys = atoi(argv[1]);
+    }
+    if(argc > 2){
+        num_lookups = atoi(argv[2]);
+    }
+    if(keys <= 0 || num_lookups <= 0){
+        help_notice();
+        return EXIT_FAILURE;
+    }
+
+    lookups = emalloc((size_t)num_lookups * 9);
+    srand(242);
+    for(i = 0; i < num_lookups; i++){
+        make_key(lookups + 9 * i, rand() % keys);
+    }
+
+    printf("%d keys, %d random lookups\n\n", keys, num_lookups);
+    printf("%-12s %10s %14s %10s\n", "Memory", "Search (s)", "dTLB misses",
+           "Found");
+    printf("-----------------------------------------------------\n");
+    run(0, keys, lookups, num_lookups);
+    run(1, keys, lookups, num_lookups);
+
+    free(lookups);
+    return EXIT_SUCCESS;
+}
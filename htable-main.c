@@ -3,15 +3,35 @@
 #include <getopt.h>
 #include <string.h>
 #include <time.h>
+#include <limits.h>
 
 #include "mylib.h"
 #include "htable.h"
+#include "cms.h"
+#include "topk.h"
+#include "shtable.h"
+#include "suggest.h"
+#include "reader.h"
+
+/* how many words of the -c file are looked up at once */
+#define BLOCK_WORDS 128
+
+/* the most words -m can track, which keeps the sketch and summary sizes
+   within an int */
+#define STREAM_MAX_ENTRIES (1 << 22)
 
 /*Variable declarations*/
 char *spellcheck_file;
 int snapshots;
 int table_size;
 int spellcheck;
+int suggestions;
+suggest suggester;
+int stream_entries;
+int report_interval;
+int report_top;
+int shards;
+int huge_pages;
 int print_table;
 int print_stats;
 hashing_t method;
@@ -20,36 +40,68 @@ hashing_t method;
  * Displays help notice.
  */
 static void help_notice(){
-    fprintf(stderr,"%s%s%s",
+    fprintf(stderr,"%s%s%s%s%s",
             "Usage: ./sample-htable [OPTION]... <STDIN>\n\n"
 
             "Perform various operations using a hash table.  By default,\n"
             "words are read from stdin and added to the hash table, before\n"
             "being printed out alongside their frequencies to stdout.\n\n",
 
+            " -a COUNT     Print up to COUNT suggested corrections after\n"
+            "              each unknown word (if -c is used)\n"
             " -c FILENAME  Check spelling of words in FILENAME using words\n"
             "              from stdin as dictionary.  Print unknown words to\n"
             "              stdout, timing info & count to stderr (ignore -p)\n"
-            " -d           Use double hashing (linear probing is the default)\n"
-            " -e           Display entire contents of hash table on stderr\n",
+            " -d           Use double hashing (linear probing is the default)\n",
+            " -e           Display entire contents of hash table on stderr\n"
+            " -g           Back the hash table with 2 MB huge pages\n"
+            " -k TOP       Report the TOP most frequent words (if -m is used)\n",
+            " -m ENTRIES   Stream stdin, tracking at most ENTRIES words and\n"
+            "              periodically reporting the most frequent, at most\n"
+            "              4194304 (ignore all but -k & -r)\n",
+            " -n SHARDS    Use a table split into SHARDS independently grown\n"
+            "              shards with 64 bit counts, at most 65536 (ignore\n"
+            "              -d, -e & -p)\n"
             " -p           Print stats info instead of frequencies & words\n"
+            " -r WORDS     Report after every WORDS words (if -m is used)\n"
             " -s SNAPSHOTS Show SNAPSHOTS stats snapshots (if -p is used)\n"
             " -t TABLESIZE Use the first prime >= TABLESIZE as htable size\n\n"
 
             " -h           Display this messagen\n");
 }
 
+/**
+ * Reads the count given to an option that only makes sense when it is
+ * positive, printing the help notice and exiting if it is not or if it
+ * is more than max.
+ * @param arg the argument given to the option.
+ * @param max the largest count allowed.
+ * @return the count.
+ */
+static int positive_arg(char *arg, int max){
+    int value = atoi(arg);
+    if(value <= 0 || value > max){
+        help_notice();
+        exit(EXIT_FAILURE);
+    }
+    return value;
+}
+
 /**
  * Processes the commandline arguments to determine options.
  * @param argc the number of arguments.
  * @param **arcv the string of arguments.
  */
 static void options(int argc, char **argv){
-    const char *optstring = "c:deps:t:h";
+    const char *optstring = "a:c:degk:m:n:pr:s:t:h";
+    char *table_arg = NULL;
     char option;
 
     while ((option = getopt(argc, argv, optstring)) != EOF) {
         switch (option) {
+            case 'a':
+                suggestions = atoi(optarg);
+                break;
             case 'c':
                 spellcheck = 1;
                 spellcheck_file = optarg;
@@ -60,14 +112,30 @@ static void options(int argc, char **argv){
             case 'e':
                 print_table = 1;
                 break;
+            case 'g':
+                huge_pages = 1;
+                break;
+            case 'k':
+                report_top = positive_arg(optarg, INT_MAX);
+                break;
+            case 'm':
+                stream_entries = positive_arg(optarg, STREAM_MAX_ENTRIES);
+                break;
+            case 'n':
+                shards = atoi(optarg);
+                break;
             case 'p':
                 print_stats = 1;
                 snapshots = 10;
                 break;
+            case 'r':
+                report_interval = positive_arg(optarg, INT_MAX);
+                break;
             case 's':
                 snapshots = atoi(optarg);
                 break;
             case 't':
+                table_arg = optarg;
                 table_size = atoi(optarg);
                 break;
             case 'h':
@@ -79,6 +147,10 @@ static void options(int argc, char **argv){
                 exit(EXIT_SUCCESS);
         }
     }
+    /* the sharded table is sized from -t, so it must be a real size */
+    if(shards > 0 && table_arg != NULL){
+        table_size = positive_arg(table_arg, INT_MAX);
+    }
 }
 
 /**
@@ -95,6 +167,128 @@ int isPrime(int n){
     return(j == 2);
 }
 
+/**
+ * Prints a report of the most frequent words seen so far.
+ * @param k the summary of the most frequent words.
+ * @param words the number of words seen so far.
+ */
+static void stream_report(topk k, unsigned long words){
+    printf("Words: %lu\n", words);
+    topk_report(k, stdout, report_top);
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * Counts one word of the stream, reporting if it is time to.
+ * @param k the summary of the most frequent words.
+ * @param c the sketch bounding the count of every word.
+ * @param word the word that was read.
+ * @param words the number of words seen so far, updated.
+ */
+static void stream_count(topk k, cms c, char *word, unsigned long *words){
+    topk_insert(k, word, cms_insert(c, word));
+    if(++*words % report_interval == 0){
+        stream_report(k, *words);
+    }
+}
+
+/**
+ * Counts words from stdin as they arrive, using a fixed amount of memory
+ * however much input there is.  The reader takes whatever input is
+ * available, so reports keep up with a slow stream.  A Count-Min Sketch
+ * bounds the count of every word, and a SpaceSaving summary of
+ * stream_entries words keeps the most frequent ones.
+ */
+static void stream_words(void){
+    topk k = topk_new(stream_entries);
+    cms c = cms_new(stream_entries * 8, 4);
+    reader r = reader_new(stdin);
+    char word[256];
+    unsigned long words = 0;
+
+    while(reader_getword(r, word, sizeof word, NULL) != EOF){
+        stream_count(k, c, word, &words);
+    }
+    if(words % report_interval != 0){
+        stream_report(k, words);
+    }
+    reader_free(r);
+    cms_free(c);
+    topk_free(k);
+}
+
+/**
+ * Adds a dictionary word from the sharded table to the suggester.
+ * @param str the word to be added.
+ * @param freq how many times the word was read.
+ */
+static void add_sharded_suggestion(char *str, uint64_t freq){
+    suggest_add(suggester, str, freq > INT_MAX ? INT_MAX : (int)freq);
+}
+
+/**
+ * Fills a sharded table from stdin, then checks spelling if selected or
+ * otherwise reports how many different words were read.
+ */
+static void sharded_words(void){
+    FILE *file;
+    reader r;
+    shtable s = shtable_new(shards, table_size);
+    char word[256];
+    clock_t fill_start, fill_end, search_start, search_end;
+    int unknown_words = 0;
+
+    fill_start = clock();
+    r = reader_new(stdin);
+    while (reader_getword(r, word, sizeof word, NULL) != EOF){
+        shtable_insert(s, word);
+    }
+    reader_free(r);
+    fill_end = clock();
+
+    if(spellcheck>0){
+        file = fopen(spellcheck_file, "r");
+        if(file != NULL){
+            if(suggestions > 0){
+                suggester = suggest_new(2);
+                shtable_foreach(s, add_sharded_suggestion);
+            }
+            search_start = clock();
+            r = reader_new(file);
+            while (reader_getword(r, word, sizeof word, NULL) != EOF) {
+                if(shtable_search(s,word) == 0){
+                    suggest_print(suggester, word, suggestions, stdout);
+                    unknown_words++;
+                }
+            }
+            reader_free(r);
+            search_end = clock();
+            if(suggestions > 0){
+                suggest_free(suggester);
+            }
+            fclose(file);
+            fprintf(stderr,
+                    "Fill Time:     %f\n"
+                    "Search time:   %f\n"
+                    "Unknown words = %d\n",
+                    (fill_end - fill_start)/(double)CLOCKS_PER_SEC,
+                    (search_end - search_start)/(double)CLOCKS_PER_SEC,
+                    unknown_words);
+        }else{
+            fprintf(stderr, "The provided file could not be opened.\n");
+        }
+    }else{
+        fprintf(stderr,
+                "Fill Time:     %f\n"
+                "Different words = %lu\n",
+                (fill_end - fill_start)/(double)CLOCKS_PER_SEC,
+                (unsigned long)shtable_num_keys(s));
+    }
+
+    shtable_free(s);
+}
+
 /**
  *Main method, initilises, fills and proforms
  *options selected on htable.
@@ -105,21 +299,48 @@ int isPrime(int n){
 int main(int argc, char **argv){
     /*Declare variables.*/
     FILE *file;
+    reader r;
     htable h;
     char word[256];
+    char block_words[BLOCK_WORDS][256];
+    char *block[BLOCK_WORDS];
+    int found[BLOCK_WORDS];
+    int lengths[BLOCK_WORDS];
+    unsigned int hashes[BLOCK_WORDS];
+    unsigned int hash;
     clock_t fill_start, fill_end, search_start, search_end;
     int unknown_words;
+    int n, i, len;
 
     /*Set default flags and values*/
     unknown_words = 0;
     spellcheck = 0;
+    suggestions = 0;
     print_table = 0;
     print_stats = 0;
     table_size = 113;
     method = LINEAR_P;
+    stream_entries = 0;
+    report_interval = 1000000;
+    report_top = 10;
+    shards = 0;
+    huge_pages = 0;
 
     /*Get flags and values from user*/
     options(argc, argv);
+    for(i = 0; i < BLOCK_WORDS; i++){
+        block[i] = block_words[i];
+    }
+
+    if(stream_entries > 0){
+        stream_words();
+        return EXIT_SUCCESS;
+    }
+
+    if(shards > 0){
+        sharded_words();
+        return EXIT_SUCCESS;
+    }
 
     /*If the user has set a table size make it prime*/
     if(table_size != 113){
@@ -132,25 +353,47 @@ int main(int argc, char **argv){
         }
     }
 
-    h = htable_new(table_size, method);
+    if(huge_pages > 0){
+        h = htable_new_huge(table_size, method);
+    }else{
+        h = htable_new(table_size, method);
+    }
  
     fill_start = clock();
-    while (getword(word, sizeof word, stdin) != EOF){
-        htable_insert(h, word);
+    r = reader_new(stdin);
+    while ((len = reader_getword(r, word, sizeof word, &hash)) != EOF){
+        htable_insert_hashed(h, word, len, hash);
     }
+    reader_free(r);
     fill_end = clock();
 
     if(spellcheck>0){
         file = fopen(spellcheck_file, "r");
         if(file != NULL){
+            if(suggestions > 0){
+                suggester = suggest_new(2);
+                htable_foreach(h, suggest_collect);
+            }
             search_start = clock();
-            while (getword(word, sizeof word, file) != EOF) {
-                if(htable_search(h,word) == 0){
-                    printf("%s\n",word);
-                    unknown_words++;
+            r = reader_new(file);
+            while ((n = reader_getwords(r, block, lengths, hashes,
+                                        BLOCK_WORDS,
+                                        sizeof block_words[0])) > 0) {
+                htable_search_batch_hashed(h, block, lengths, hashes, n,
+                                           found);
+                for(i = 0; i < n; i++){
+                    if(found[i] == 0){
+                        suggest_print(suggester, block[i], suggestions,
+                                      stdout);
+                        unknown_words++;
+                    }
                 }
             }
+            reader_free(r);
             search_end = clock();
+            if(suggestions > 0){
+                suggest_free(suggester);
+            }
             fprintf(stderr,
                     "Fill Time:     %f\n"
                     "Search time:   %f\n"
@@ -4,13 +4,18 @@
 #include "htable.h"
 #include "mylib.h"
 
+/* how many searches htable_search_batch overlaps */
+#define HTABLE_BATCH 16
+
 /**
  * num_keys is the number of keys the htable is currnetly holding.
  * capacity is how amny keys the htable can hold.
  * *frequencies stores the frequencies of different keys.
  * *stats stores the number of collisions before an empty space was found.
  * **keys stores the keys
+ * *lengths stores the length of each key.
  * method is either linear probing or double hashing.
+ * huge is true if the arrays are backed by huge pages.
  */
 struct htablerec{
     int num_keys;
@@ -18,37 +23,92 @@ struct htablerec{
     int *frequencies;
     int *stats;
     char **keys;
+    int *lengths;
     hashing_t method;
+    int huge;
 };
 
 /**
- * Creates a new htable, frequencies array and stats array.
- * Decides what collision method is used.
- * Allocates memory and sets their values to null.
+ * Allocates one of the htable's arrays.
+ * @param h the htable the array belongs to.
+ * @param size the size of the array in bytes.
+ * @return the array.
+ */
+static void *htable_array_new(htable h, size_t size){
+    return h->huge ? ealloc_huge(size) : emalloc(size);
+}
+
+/**
+ * Frees one of the htable's arrays.
+ * @param h the htable the array belongs to.
+ * @param array the array to be freed.
+ * @param size the size the array was allocated with.
+ */
+static void htable_array_free(htable h, void *array, size_t size){
+    if(h->huge){
+        efree_huge(array, size);
+    }else{
+        free(array);
+    }
+}
+
+/**
+ * Creates a new htable, allocating its arrays either from the heap or
+ * from huge pages, and sets their values to null.
  * @param capacity how amny keys the htable can store.
  * @param hash_type either linear probing or double hashing.
+ * @param huge true to back the arrays with huge pages.
  * @return the created htable.
  */
-htable htable_new(int capacity, hashing_t hash_type){
+static htable htable_create(int capacity, hashing_t hash_type, int huge){
     int i;
     htable newhtable = emalloc(sizeof *newhtable);
     newhtable->method = hash_type;
     newhtable->capacity = capacity;
     newhtable->num_keys = 0;
-    newhtable->frequencies = emalloc(newhtable->capacity * sizeof
-                                     newhtable->frequencies[0]);
-    newhtable->stats = emalloc(newhtable->capacity * sizeof
-                               newhtable->stats[0]);
-    newhtable->keys = emalloc(newhtable->capacity * sizeof
-                              newhtable->keys[0]);                                
+    newhtable->huge = huge;
+    newhtable->frequencies = htable_array_new(newhtable, newhtable->capacity *
+                                              sizeof newhtable->frequencies[0]);
+    newhtable->stats = htable_array_new(newhtable, newhtable->capacity *
+                                        sizeof newhtable->stats[0]);
+    newhtable->keys = htable_array_new(newhtable, newhtable->capacity *
+                                       sizeof newhtable->keys[0]);
+    newhtable->lengths = htable_array_new(newhtable, newhtable->capacity *
+                                          sizeof newhtable->lengths[0]);
     for(i=0;i<capacity;i++){
         newhtable->frequencies[i] = 0;
         newhtable->stats[i] = 0;
         newhtable->keys[i] = NULL;
+        newhtable->lengths[i] = 0;
     }
     return newhtable;
 }
 
+/**
+ * Creates a new htable, frequencies array and stats array.
+ * Decides what collision method is used.
+ * Allocates memory and sets their values to null.
+ * @param capacity how amny keys the htable can store.
+ * @param hash_type either linear probing or double hashing.
+ * @return the created htable.
+ */
+htable htable_new(int capacity, hashing_t hash_type){
+    return htable_create(capacity, hash_type, 0);
+}
+
+/**
+ * Creates a new htable like htable_new, but with the keys, frequencies
+ * and stats arrays backed by 2 MB huge pages where the system allows.
+ * Large tables are probed at random, so fewer, bigger pages mean far
+ * fewer TLB misses.
+ * @param capacity how amny keys the htable can store.
+ * @param hash_type either linear probing or double hashing.
+ * @return the created htable.
+ */
+htable htable_new_huge(int capacity, hashing_t hash_type){
+    return htable_create(capacity, hash_type, 1);
+}
+
 /**
  * Frees all memory allocated to the htable.
  * @param h the htable to be freed.
@@ -58,21 +118,24 @@ void htable_free(htable h){
     for(i=0;i<h->capacity;i++){
         free(h->keys[i]);
     }	
-    free(h->frequencies);
-    free(h->keys);
-    free(h->stats);
+    htable_array_free(h, h->frequencies,
+                      h->capacity * sizeof h->frequencies[0]);
+    htable_array_free(h, h->keys, h->capacity * sizeof h->keys[0]);
+    htable_array_free(h, h->stats, h->capacity * sizeof h->stats[0]);
+    htable_array_free(h, h->lengths, h->capacity * sizeof h->lengths[0]);
     free(h);
 }
 
 /**
- * Converts a given word to an integer.
+ * Converts a given word to an integer.  getword_hash makes the same
+ * integer while it reads a word.
  * @param *word the word to be converted.
  * @return the int that has been made.
  */
 static unsigned int htable_word_to_int(char *word) {
     unsigned int result = 0;	
     while (*word != '\0') {
-        result = (*word++ + 31 * result);
+        result = WORD_HASH(result, *word++);
     }
     return result;
 }
@@ -94,7 +157,20 @@ static unsigned int htable_step(htable h, unsigned int i_key) {
  * @return the frequency of the string 0 if hatble is full.
  */
 int htable_insert(htable h, char *str){
-    unsigned int strvalue = htable_word_to_int(str);
+    return htable_insert_hashed(h, str, strlen(str), htable_word_to_int(str));
+}
+
+/**
+ * Inserts a string that has already been measured and hashed, such as by
+ * getword_hash, so its characters are only read again to compare them
+ * with keys of the same length.
+ * @param h the htable to be inserted into.
+ * @param str the string to be inserted.
+ * @param len the length of str.
+ * @param strvalue str converted to an int, as by getword_hash.
+ * @return the frequency of the string 0 if hatble is full.
+ */
+int htable_insert_hashed(htable h, char *str, int len, unsigned int strvalue){
     unsigned int keyaddress = strvalue % h->capacity;
     unsigned int step = 1;                    	
     int i = 0;
@@ -103,13 +179,15 @@ int htable_insert(htable h, char *str){
     }
     while(i<h->capacity){
         if(h->keys[keyaddress] == NULL){
-            h->keys[keyaddress] = emalloc((strlen(str)+1)*sizeof str[0]);
-            strcpy(h->keys[keyaddress], str);
+            h->keys[keyaddress] = emalloc((len+1)*sizeof str[0]);
+            memcpy(h->keys[keyaddress], str, len+1);
+            h->lengths[keyaddress] = len;
             h->frequencies[keyaddress]++;
             h->stats[h->num_keys] = i;
             h->num_keys++;
             return h->frequencies[keyaddress];
-        } else if(strcmp(str, h->keys[keyaddress])==0){
+        } else if(h->lengths[keyaddress] == len &&
+                  memcmp(str, h->keys[keyaddress], len)==0){
             h->frequencies[keyaddress]++;
             return h->frequencies[keyaddress];
         } else{
@@ -121,6 +199,20 @@ int htable_insert(htable h, char *str){
     return 0;
 }
 
+/**
+ * Calls a function on every key in the htable, in table order.
+ * @param h the htable to be traversed.
+ * @param f a function that is passed each key and its frequency.
+ */
+void htable_foreach(htable h, void f(char *str, int freq)){
+    int i;
+    for(i=0;i<h->capacity;i++){
+        if(h->keys[i] != NULL){
+            f(h->keys[i], h->frequencies[i]);
+        }
+    }
+}
+
 /**
  * Prints the htable index, frequencies, stats and keys.
  * @param h the table to be printed.
@@ -141,13 +233,15 @@ void htable_print_entire_table(htable h){
 }
 
 /**
- * Searches the htable for a spicific string.
+ * Searches the htable for a string that has already been measured and
+ * hashed, such as by getword_hash.
  * @param h the htable to be searched.
- * @param *str the string to be searched for.
- * @return the fthe ammount of times the string has been stored.
+ * @param str the string to be searched for.
+ * @param len the length of str.
+ * @param strvalue str converted to an int, as by getword_hash.
+ * @return the ammount of times the string has been stored.
  */
-int htable_search(htable h, char *str){
-    unsigned int strvalue = htable_word_to_int(str);
+int htable_search_hashed(htable h, char *str, int len, unsigned int strvalue){
     unsigned int keyaddress = strvalue % h->capacity;
     unsigned int step = 1;
     int i = 0;
@@ -155,7 +249,8 @@ int htable_search(htable h, char *str){
         step = htable_step(h, strvalue);
     }
     while(i<h->capacity && (h->frequencies[keyaddress] >0 &&
-                            strcmp(h->keys[keyaddress],str)!=0)){
+                            (h->lengths[keyaddress] != len ||
+                             memcmp(h->keys[keyaddress],str,len)!=0))){
         i++;
         keyaddress=(keyaddress+step)% h->capacity;
     }
@@ -166,6 +261,76 @@ int htable_search(htable h, char *str){
     }
 }
 
+/**
+ * Searches the htable for a spicific string.
+ * @param h the htable to be searched.
+ * @param *str the string to be searched for.
+ * @return the fthe ammount of times the string has been stored.
+ */
+int htable_search(htable h, char *str){
+    return htable_search_hashed(h, str, strlen(str), htable_word_to_int(str));
+}
+
+/**
+ * Searches the htable for many strings that have already been measured
+ * and hashed.  The home slots of a group of strings are all prefetched,
+ * then the keys stored there, before any probe is resolved, so their
+ * cache misses overlap instead of each search waiting on the one before.
+ * @param h the htable to be searched.
+ * @param words the strings to be searched for.
+ * @param lengths the length of each string.
+ * @param values each string converted to an int, as by getword_hash.
+ * @param n the number of strings.
+ * @param results set to the frequency of each string, 0 if not found.
+ */
+void htable_search_batch_hashed(htable h, char **words, int *lengths,
+                                unsigned int *values, int n, int *results){
+    unsigned int keyaddress;
+    int base, i, m;
+    for(base = 0; base < n; base += HTABLE_BATCH){
+        m = n - base < HTABLE_BATCH ? n - base : HTABLE_BATCH;
+        for(i = base; i < base + m; i++){
+            keyaddress = values[i] % h->capacity;
+            PREFETCH(&h->keys[keyaddress]);
+            PREFETCH(&h->lengths[keyaddress]);
+            PREFETCH(&h->frequencies[keyaddress]);
+        }
+        for(i = base; i < base + m; i++){
+            keyaddress = values[i] % h->capacity;
+            if(h->keys[keyaddress] != NULL){
+                PREFETCH(h->keys[keyaddress]);
+            }
+        }
+        for(i = base; i < base + m; i++){
+            results[i] = htable_search_hashed(h, words[i], lengths[i],
+                                              values[i]);
+        }
+    }
+}
+
+/**
+ * Searches the htable for many strings at once, see
+ * htable_search_batch_hashed.
+ * @param h the htable to be searched.
+ * @param words the strings to be searched for.
+ * @param n the number of strings.
+ * @param results set to the frequency of each string, 0 if not found.
+ */
+void htable_search_batch(htable h, char **words, int n, int *results){
+    int lengths[HTABLE_BATCH];
+    unsigned int values[HTABLE_BATCH];
+    int base, i, m;
+    for(base = 0; base < n; base += HTABLE_BATCH){
+        m = n - base < HTABLE_BATCH ? n - base : HTABLE_BATCH;
+        for(i = 0; i < m; i++){
+            lengths[i] = strlen(words[base + i]);
+            values[i] = htable_word_to_int(words[base + i]);
+        }
+        htable_search_batch_hashed(h, words + base, lengths, values, m,
+                                   results + base);
+    }
+}
+
 /**
  * Prints out a line of data from the hash table to reflect the state
  * the table was in when it was a certain percentage full.
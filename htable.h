@@ -6,11 +6,22 @@
 typedef struct htablerec *htable;
 typedef enum hashing_e { LINEAR_P, DOUBLE_H } hashing_t;
 
+extern void   htable_foreach(htable h, void f(char *str, int freq));
 extern void   htable_free(htable h);
 extern int    htable_insert(htable h, char *str);
+extern int    htable_insert_hashed(htable h, char *str, int len,
+                                   unsigned int strvalue);
 extern htable htable_new(int capacity, hashing_t hash_type);
+extern htable htable_new_huge(int capacity, hashing_t hash_type);
 extern void   htable_print(htable h, FILE *stream);
 extern int    htable_search(htable h, char *str);
+extern void   htable_search_batch(htable h, char **words, int n,
+                                  int *results);
+extern void   htable_search_batch_hashed(htable h, char **words,
+                                         int *lengths, unsigned int *values,
+                                         int n, int *results);
+extern int    htable_search_hashed(htable h, char *str, int len,
+                                   unsigned int strvalue);
 extern void   htable_print_entire_table(htable h);
 extern void   htable_print_stats(htable h, FILE *stream, int num_stats);
 
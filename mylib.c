@@ -1,7 +1,9 @@
+#define _GNU_SOURCE /* for MAP_ANONYMOUS, MAP_HUGETLB and madvise */
 #include <stdio.h> /* for fprintf */
 #include <stdlib.h> /* for size_t, malloc, realloc, exit */
 #include <assert.h>
 #include <ctype.h>
+#include <sys/mman.h>
 
 #include "mylib.h"
 
@@ -19,31 +21,214 @@ void *emalloc(size_t s) {
     return result;
 }
 
+/**
+ * Resizes a block of memory.
+ * @param p the memory block to be resized.
+ * @param s the new size of the memory block.
+ * @return a pointer to the resized memory block.
+ */
+void *erealloc(void *p, size_t s) {
+    void *result = realloc(p, s);
+    if (NULL == result){
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/* the size of an x86-64 huge page */
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+/**
+ * Rounds a size up to a whole number of huge pages.
+ * @param s the size in bytes.
+ * @return the rounded size.
+ */
+static size_t huge_round(size_t s) {
+    return (s + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+/**
+ * Allocates zeroed memory backed by 2 MB huge pages where possible, so
+ * large randomly accessed arrays need far fewer TLB entries.  Reserved
+ * huge pages (MAP_HUGETLB) are tried first, then transparent huge pages
+ * are requested with madvise, then it falls back to ordinary pages.
+ * @param s the size of the memory block to be allocated.
+ * @return a pointer to the memory block, to be freed with efree_huge.
+ */
+void *ealloc_huge(size_t s) {
+    void *result = MAP_FAILED;
+    char *start, *aligned;
+    s = huge_round(s);
+#ifdef MAP_HUGETLB
+    result = mmap(NULL, s, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (MAP_FAILED == result) {
+        /* map a huge page extra so the block can start on a 2 MB
+           boundary, otherwise only its aligned interior can be backed
+           by transparent huge pages */
+        result = mmap(NULL, s + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == result) {
+            fprintf(stderr, "Memory allocation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+        start = result;
+        aligned = start + (huge_round((size_t)start) - (size_t)start);
+        if (aligned > start) {
+            munmap(start, aligned - start);
+        }
+        munmap(aligned + s, start + HUGE_PAGE_SIZE - aligned);
+        result = aligned;
+#ifdef MADV_HUGEPAGE
+        madvise(result, s, MADV_HUGEPAGE);
+#endif
+    }
+    return result;
+}
+
+/**
+ * Frees memory allocated by ealloc_huge.
+ * @param p the memory block to be freed.
+ * @param s the size the block was allocated with.
+ */
+void efree_huge(void *p, size_t s) {
+    if (NULL != p) {
+        munmap(p, huge_round(s));
+    }
+}
+
+/*
+ * Splits the next word out of the characters GETC gives, storing it
+ * from w and hashing it into h with WORD_HASH.  Words are made of
+ * letters and digits, lowercased, with apostrophes inside them dropped.
+ * At most limit - 1 characters are stored, then the word is ended with
+ * a \0.  c is left EOF and w unmoved if there was no word.
+ * Both getword_hash and source_getword split words with this, so they
+ * always agree while each reads characters in its own way.
+ */
+#define SPLIT_WORD(GETC, c, w, limit, h) \
+	do { \
+		/* skip to the start of the word */ \
+		while (!isalnum(c = (GETC)) && EOF != c) \
+			; \
+		if (EOF != c) { \
+			if (--limit > 0) { /* allow for the \0 */ \
+				*w = tolower(c); \
+				h = WORD_HASH(h, *w++); \
+			} \
+			while (--limit > 0) { \
+				if (isalnum(c = (GETC))) { \
+					*w = tolower(c); \
+					h = WORD_HASH(h, *w++); \
+				} else if ('\'' == c) { \
+					limit++; \
+				} else { \
+					break; \
+				} \
+			} \
+			*w = '\0'; \
+		} \
+	} while (0)
+
+/**
+ * Hashes a string with FNV-1a, which spreads well over the low bits
+ * used to index a power of two sized table.
+ * @param str the string to be hashed.
+ * @return the hash of the string.
+ */
+unsigned int fnv_hash(char *str) {
+	unsigned int result = 2166136261u;
+	while (*str != '\0') {
+		result ^= (unsigned char)*str++;
+		result *= 16777619u;
+	}
+	return result;
+}
+
 /**
  * Gets word from a file.
  */
 int getword(char *s, int limit, FILE *stream) {
+	return getword_hash(s, limit, stream, NULL);
+}
+
+/**
+ * Gets word from a file like getword, hashing it with WORD_HASH as each
+ * character is read so the word never has to be scanned again to hash
+ * or measure it.
+ * @param s where the word is written.
+ * @param limit the size of s.
+ * @param stream the file to read from.
+ * @param hash set to the hash of the word, unless it is NULL.
+ * @return the length of the word, or EOF at the end of the file.
+ */
+int getword_hash(char *s, int limit, FILE *stream, unsigned int *hash) {
 	int c;
 	char *w = s;
+	unsigned int h = 0;
 	assert(limit > 0 && s != NULL && stream != NULL);
-	
-	/* skip to the start of the word */
-	while (!isalnum(c = getc(stream)) && EOF != c)
-		;
-	if (EOF == c) {
+
+	SPLIT_WORD(getc(stream), c, w, limit, h);
+	if (EOF == c && w == s) {
+		return EOF;
+	}
+	if (NULL != hash) {
+		*hash = h;
+	}
+	return w - s;
+}
+
+/**
+ * Asks a source for more characters once those from pos to end are used
+ * up, keeping the caller's copies of pos and end in step.
+ * @param src the source.
+ * @param pos the caller's copy of src->pos, updated.
+ * @param end the caller's copy of src->end, updated.
+ * @return the next character, or EOF at the end of the source.
+ */
+static int source_refill(struct wordsource *src, unsigned char **pos,
+                         unsigned char **end) {
+	int c;
+	src->pos = *pos;
+	c = src->refill(src);
+	*pos = src->pos;
+	*end = src->end;
+	return c;
+}
+
+/* gets the next character of a source, with pos and end held in locals
+   as writes to the word could otherwise alias them */
+#define SOURCE_GETC(src, pos, end) \
+	((pos) < (end) ? *(pos)++ : source_refill((src), &(pos), &(end)))
+
+/**
+ * Gets a word from a source of characters, hashing it with WORD_HASH as
+ * each character is read so the word never has to be scanned again to
+ * hash or measure it.  Words are made of letters and digits, lowercased,
+ * with apostrophes inside them dropped, the same as getword_hash.
+ * @param src the source to read from.
+ * @param s where the word is written.
+ * @param limit the size of s.
+ * @param hash set to the hash of the word, unless it is NULL.
+ * @return the length of the word, or EOF at the end of the source.
+ */
+int source_getword(struct wordsource *src, char *s, int limit,
+                   unsigned int *hash) {
+	unsigned char *pos = src->pos, *end = src->end;
+	int c;
+	char *w = s;
+	unsigned int h = 0;
+	assert(limit > 0 && s != NULL && src != NULL);
+
+	SPLIT_WORD(SOURCE_GETC(src, pos, end), c, w, limit, h);
+	src->pos = pos;
+	if (EOF == c && w == s) {
 		return EOF;
-	} else if (--limit > 0) { /* reduce limit by 1 to allow for the \0 */
-		*w++ = tolower(c);
 	}
-	while (--limit > 0) {
-		if (isalnum(c = getc(stream))) {
-			*w++ = tolower(c);
-		} else if ('\'' == c) {
-			limit++;
-		} else {
-			break;
-		}
+	if (NULL != hash) {
+		*hash = h;
 	}
-	*w = '\0';
 	return w - s;
 }
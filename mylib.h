@@ -3,7 +3,35 @@
 
 #include <stddef.h>
 
+/* hint that memory at p will be read soon, where the compiler allows */
+#ifdef __GNUC__
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p) ((void)0)
+#endif
+
+/* adds character c to the hash h of the characters before it, the hash
+   used to place words in a htable */
+#define WORD_HASH(h, c) ((c) + 31 * (h))
+
+/* somewhere words can be read from: the characters from pos up to end,
+   then whatever refill returns once they run out.  refill gives the next
+   character, or EOF, and may point pos and end at more characters. */
+struct wordsource {
+    unsigned char *pos;
+    unsigned char *end;
+    int (*refill)(struct wordsource *src);
+};
+
 extern void *emalloc(size_t);
+extern void *erealloc(void *, size_t);
+extern void *ealloc_huge(size_t);
+extern void  efree_huge(void *, size_t);
+extern unsigned int fnv_hash(char *str);
 extern int getword(char *s, int limit, FILE *stream);
+extern int getword_hash(char *s, int limit, FILE *stream,
+                        unsigned int *hash);
+extern int source_getword(struct wordsource *src, char *s, int limit,
+                          unsigned int *hash);
 
 #endif
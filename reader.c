@@ -0,0 +1,599 @@
+#define _GNU_SOURCE /* for syscall */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "mylib.h"
+
+/* io_uring is driven with raw system calls, so only its header is needed */
+#if defined(__linux__) && defined(__GNUC__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define READER_URING
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+/* the number of buffers, all but the one being split into words can be
+   filling at once */
+#define READER_BUFFERS 4
+
+/* the size of each buffer */
+#define READER_BUFFER_SIZE (1 << 20)
+
+#ifdef READER_URING
+/**
+ * The parts of an io_uring mapped into this process.
+ * fd is the ring's file descriptor, -1 if there is no ring.
+ * sq_* and cq_* point into the submission and completion rings.
+ * *sqes stores the submission queue entries.
+ * in_flight is the number of reads queued and not yet completed.
+ * pending is how many of those are queued but not yet taken by the
+ * kernel, they are passed on by the next io_uring_enter.
+ * error is the error io_uring_enter last failed with for good.
+ */
+struct reader_ring{
+    int fd;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    struct io_uring_cqe *cqes;
+    int in_flight;
+    int pending;
+    int error;
+};
+#endif
+
+/**
+ * Reads a file ahead into several large buffers while the words of an
+ * earlier buffer are handed out, so the caller is never left waiting on
+ * a read it could have overlapped with work.
+ *
+ * A regular file is read with io_uring where the kernel has it: every
+ * free buffer has a read at its own offset in flight, and buffers are
+ * used in order of offset.  Anything else, or a kernel without io_uring,
+ * is read by a thread that fills each free buffer in turn, and so is the
+ * rest of a file if io_uring fails part way through.
+ *
+ * fd is the file descriptor being read.
+ * *buffers stores the buffers, used round robin.
+ * *lengths stores how many bytes each filled buffer holds, 0 at the end
+ * of the file.
+ * *filled stores true for each buffer holding data not yet handed out.
+ * src is where words are split from, its pos and end mark what is left
+ * of the current buffer and its refill moves on to the next buffer.  It
+ * comes first so the source can be turned back into its reader.
+ * current is the buffer words are being taken from.
+ * done is true once the end of the file has been reached.
+ * uring is true if the file is read with io_uring, otherwise thread,
+ * lock and cond are used to pass buffers to and from the reading thread,
+ * and stop asks it to finish.
+ * *offsets stores the file offset each buffer was read from, and next is
+ * the offset of the next read to submit.
+ */
+struct readerrec{
+    struct wordsource src;
+    int fd;
+    char *buffers[READER_BUFFERS];
+    long lengths[READER_BUFFERS];
+    int filled[READER_BUFFERS];
+    int current;
+    int done;
+    int uring;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stop;
+#ifdef READER_URING
+    struct reader_ring ring;
+    struct iovec iovecs[READER_BUFFERS];
+    off_t offsets[READER_BUFFERS];
+    off_t next;
+#endif
+};
+
+/**
+ * Reports a read error and treats it as the end of the file.
+ * @param error the error number.
+ * @return 0, the length of a buffer at the end of the file.
+ */
+static long reader_error(int error){
+    fprintf(stderr, "read failed: %s\n", strerror(error));
+    return 0;
+}
+
+#ifdef READER_URING
+/**
+ * Sets up an io_uring with room for a read into every buffer.
+ * @param ring the ring to set up.
+ * @return true if it was set up, false if the kernel does not allow it.
+ */
+static int reader_ring_new(struct reader_ring *ring){
+    struct io_uring_params p;
+    memset(&p, 0, sizeof p);
+    ring->fd = syscall(__NR_io_uring_setup, READER_BUFFERS, &p);
+    if(ring->fd < 0){
+        return 0;
+    }
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP){
+        if(ring->cq_size > ring->sq_size){
+            ring->sq_size = ring->cq_size;
+        }
+        ring->cq_size = 0;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    ring->cq_ptr = ring->sq_ptr;
+    if(ring->sq_ptr != MAP_FAILED && ring->cq_size > 0){
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd,
+                            IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = MAP_FAILED;
+    if(ring->sq_ptr != MAP_FAILED && ring->cq_ptr != MAP_FAILED){
+        ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_SQES);
+    }
+    if(ring->sqes == MAP_FAILED){
+        if(ring->sq_ptr != MAP_FAILED){
+            munmap(ring->sq_ptr, ring->sq_size);
+        }
+        if(ring->cq_size > 0 && ring->cq_ptr != MAP_FAILED){
+            munmap(ring->cq_ptr, ring->cq_size);
+        }
+        close(ring->fd);
+        ring->fd = -1;
+        return 0;
+    }
+    ring->sq_tail = (unsigned int *)((char *)ring->sq_ptr + p.sq_off.tail);
+    ring->sq_mask = (unsigned int *)((char *)ring->sq_ptr + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)((char *)ring->sq_ptr + p.sq_off.array);
+    ring->cq_head = (unsigned int *)((char *)ring->cq_ptr + p.cq_off.head);
+    ring->cq_tail = (unsigned int *)((char *)ring->cq_ptr + p.cq_off.tail);
+    ring->cq_mask = (unsigned int *)((char *)ring->cq_ptr + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ptr +
+                                         p.cq_off.cqes);
+    ring->in_flight = 0;
+    ring->pending = 0;
+    return 1;
+}
+
+/**
+ * Unmaps and closes an io_uring.  No reads may be in flight.
+ * @param ring the ring to free.
+ */
+static void reader_ring_free(struct reader_ring *ring){
+    munmap(ring->sqes, ring->sqes_size);
+    if(ring->cq_size > 0){
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+}
+
+/**
+ * Passes the pending reads to the kernel, and waits for a read to
+ * complete if asked.  Reads the kernel does not take stay pending, to be
+ * passed on again by the next call.
+ * @param r the reader.
+ * @param wait true to wait for a completion.
+ * @return true unless io_uring has failed in a way that will not go
+ * away, false if the reader must stop using it.
+ */
+static int reader_enter(reader r, int wait){
+    struct reader_ring *ring = &r->ring;
+    long n = syscall(__NR_io_uring_enter, ring->fd, ring->pending,
+                     wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0,
+                     NULL, 0);
+    if(n >= 0){
+        ring->pending -= (int)n;
+        return 1;
+    }
+    if(errno == EINTR){
+        return 1;
+    }
+    /* short of resources, which reads already submitted will give back
+       as they complete */
+    if((errno == EAGAIN || errno == EBUSY) &&
+       ring->in_flight > ring->pending){
+        sched_yield();
+        return 1;
+    }
+    ring->error = errno;
+    return 0;
+}
+
+/**
+ * Waits for the reads the kernel has taken to complete, without asking
+ * it to wait, and throws their results away.  Used once io_uring has
+ * failed, as the buffers must not be freed or reused while the kernel
+ * could still write to them.
+ * @param r the reader.
+ */
+static void reader_drain(reader r){
+    struct reader_ring *ring = &r->ring;
+    unsigned int head;
+    while(ring->in_flight > ring->pending){
+        head = *ring->cq_head;
+        if(head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)){
+            sched_yield();
+        }else{
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            ring->in_flight--;
+        }
+    }
+    ring->in_flight = 0;
+    ring->pending = 0;
+}
+
+/**
+ * Queues a read filling buffer i from the next offset of the file and
+ * passes it to the kernel.  If the kernel does not take it, it stays
+ * queued and is passed on again when next waiting for a read.
+ * @param r the reader.
+ * @param i the buffer to fill.
+ */
+static void reader_submit(reader r, int i){
+    struct reader_ring *ring = &r->ring;
+    unsigned int tail = *ring->sq_tail;
+    unsigned int slot = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[slot];
+
+    memset(sqe, 0, sizeof *sqe);
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = r->fd;
+    sqe->addr = (unsigned long)&r->iovecs[i];
+    sqe->len = 1;
+    sqe->off = r->next;
+    sqe->user_data = i;
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->offsets[i] = r->next;
+    r->next += READER_BUFFER_SIZE;
+    r->filled[i] = 0;
+    ring->in_flight++;
+    ring->pending++;
+    reader_enter(r, 0);
+}
+
+/**
+ * Waits for the next read to complete and records its result.
+ * @param r the reader.
+ * @return true if a read completed, false if io_uring has failed.
+ */
+static int reader_complete(reader r){
+    struct reader_ring *ring = &r->ring;
+    unsigned int head = *ring->cq_head;
+    struct io_uring_cqe *cqe;
+    int i;
+
+    while(head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)){
+        if(!reader_enter(r, 1)){
+            return 0;
+        }
+    }
+    cqe = &ring->cqes[head & *ring->cq_mask];
+    i = (int)cqe->user_data;
+    r->lengths[i] = cqe->res < 0 ? -cqe->res : cqe->res;
+    r->filled[i] = cqe->res < 0 ? -1 : 1;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    ring->in_flight--;
+    return 1;
+}
+
+/**
+ * Waits until buffer i has been filled with the data that follows the
+ * previous buffer, rereading from the right offset if an earlier read
+ * came up short.
+ * @param r the reader.
+ * @param i the buffer to wait for.
+ * @param expected the offset the buffer must start at.
+ * @return the number of bytes in the buffer, or -1 if io_uring has
+ * failed.
+ */
+static long reader_wait_uring(reader r, int i, off_t expected){
+    int j;
+    while(1){
+        while(r->filled[i] == 0){
+            if(!reader_complete(r)){
+                return -1;
+            }
+        }
+        if(r->filled[i] > 0 && r->offsets[i] == expected){
+            return r->lengths[i];
+        }
+        if(r->filled[i] < 0 && r->lengths[i] != EINTR &&
+           r->lengths[i] != EAGAIN){
+            r->filled[i] = 1;
+            r->lengths[i] = reader_error((int)r->lengths[i]);
+            return 0;
+        }
+        /* the reads already in flight are at the wrong offsets, so let
+           them finish and start again from where the data stopped */
+        while(r->ring.in_flight > 0){
+            if(!reader_complete(r)){
+                return -1;
+            }
+        }
+        r->next = expected;
+        for(j = 0; j < READER_BUFFERS; j++){
+            reader_submit(r, (i + j) % READER_BUFFERS);
+        }
+    }
+}
+#endif
+
+/**
+ * Fills each buffer in turn from the file, waiting whenever every
+ * buffer is full, until the end of the file or until asked to stop.
+ * @param arg the reader.
+ * @return NULL.
+ */
+static void *reader_thread(void *arg){
+    reader r = arg;
+    long n;
+    int i = 0;
+
+    while(1){
+        pthread_mutex_lock(&r->lock);
+        while(r->filled[i] && !r->stop){
+            pthread_cond_wait(&r->cond, &r->lock);
+        }
+        if(r->stop){
+            pthread_mutex_unlock(&r->lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&r->lock);
+
+        while((n = read(r->fd, r->buffers[i], READER_BUFFER_SIZE)) < 0 &&
+              errno == EINTR)
+            ;
+        if(n < 0){
+            n = reader_error(errno);
+        }
+
+        pthread_mutex_lock(&r->lock);
+        r->lengths[i] = n;
+        r->filled[i] = 1;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+        if(n == 0){
+            return NULL;
+        }
+        i = (i + 1) % READER_BUFFERS;
+    }
+}
+
+/**
+ * Starts the thread that reads the file.
+ * @param r the reader.
+ */
+static void reader_thread_start(reader r){
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    if(pthread_create(&r->thread, NULL, reader_thread, r) != 0){
+        fprintf(stderr, "Thread creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+#ifdef READER_URING
+/**
+ * Stops using io_uring once it has failed, and reads the rest of the
+ * file with a thread instead.  Everything read into the buffers is
+ * dropped, and the thread starts again from offset.
+ * @param r the reader.
+ * @param offset where the words handed out so far stop.
+ */
+static void reader_fallback(reader r, off_t offset){
+    int i;
+    fprintf(stderr, "io_uring_enter failed: %s\n", strerror(r->ring.error));
+    reader_drain(r);
+    reader_ring_free(&r->ring);
+    r->uring = 0;
+    if(lseek(r->fd, offset, SEEK_SET) < 0){
+        fprintf(stderr, "lseek failed: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < READER_BUFFERS; i++){
+        r->filled[i] = 0;
+    }
+    r->current = 0;
+    r->src.pos = NULL;
+    r->src.end = NULL;
+    reader_thread_start(r);
+}
+#endif
+
+/**
+ * Hands the current buffer back to be refilled and moves on to the next
+ * one, waiting for it to be filled if need be.
+ * @param src the reader's word source.
+ * @return the first character of the next buffer, or EOF at the end of
+ * the file.
+ */
+static int reader_next(struct wordsource *src){
+    reader r = (reader)src;
+    long n;
+#ifdef READER_URING
+    off_t expected;
+#endif
+    if(r->done){
+        return EOF;
+    }
+#ifdef READER_URING
+    if(r->uring){
+        expected = r->next - (off_t)READER_BUFFERS * READER_BUFFER_SIZE;
+        if(r->src.pos != NULL){
+            expected = r->offsets[r->current] + r->lengths[r->current];
+            reader_submit(r, r->current);
+            r->current = (r->current + 1) % READER_BUFFERS;
+        }
+        n = reader_wait_uring(r, r->current, expected);
+        if(n >= 0){
+            r->src.pos = (unsigned char *)r->buffers[r->current];
+            r->src.end = r->src.pos + n;
+            if(n == 0){
+                r->done = 1;
+                return EOF;
+            }
+            return *r->src.pos++;
+        }
+        reader_fallback(r, expected);
+    }
+#endif
+    pthread_mutex_lock(&r->lock);
+    if(r->src.pos != NULL){
+        r->filled[r->current] = 0;
+        pthread_cond_broadcast(&r->cond);
+        r->current = (r->current + 1) % READER_BUFFERS;
+    }
+    while(!r->filled[r->current]){
+        pthread_cond_wait(&r->cond, &r->lock);
+    }
+    n = r->lengths[r->current];
+    pthread_mutex_unlock(&r->lock);
+    r->src.pos = (unsigned char *)r->buffers[r->current];
+    r->src.end = r->src.pos + n;
+    if(n == 0){
+        r->done = 1;
+        return EOF;
+    }
+    return *r->src.pos++;
+}
+
+/**
+ * Creates a reader of a stream and starts reading ahead.  Nothing
+ * should have been read from the stream through stdio beforehand, as
+ * the reader reads its file descriptor directly.
+ * @param stream the stream to read.
+ * @return the created reader.
+ */
+reader reader_new(FILE *stream){
+    int i;
+#ifdef READER_URING
+    struct stat st;
+#endif
+    reader r = emalloc(sizeof *r);
+
+    r->fd = fileno(stream);
+    for(i = 0; i < READER_BUFFERS; i++){
+        r->buffers[i] = emalloc(READER_BUFFER_SIZE);
+        r->lengths[i] = 0;
+        r->filled[i] = 0;
+    }
+    r->current = 0;
+    r->src.pos = NULL;
+    r->src.end = NULL;
+    r->src.refill = reader_next;
+    r->done = 0;
+    r->stop = 0;
+    r->uring = 0;
+#ifdef READER_URING
+    if(fstat(r->fd, &st) == 0 && S_ISREG(st.st_mode) &&
+       (r->next = lseek(r->fd, 0, SEEK_CUR)) >= 0 &&
+       reader_ring_new(&r->ring)){
+        r->uring = 1;
+        for(i = 0; i < READER_BUFFERS; i++){
+            r->iovecs[i].iov_base = r->buffers[i];
+            r->iovecs[i].iov_len = READER_BUFFER_SIZE;
+            reader_submit(r, i);
+        }
+        return r;
+    }
+#endif
+    reader_thread_start(r);
+    return r;
+}
+
+/**
+ * Frees all memory allocated to the reader, first waiting for or
+ * stopping any reads still under way.
+ * @param r the reader to be freed.
+ */
+void reader_free(reader r){
+    int i;
+#ifdef READER_URING
+    if(r->uring){
+        while(r->ring.in_flight > 0 && reader_complete(r))
+            ;
+        reader_drain(r);
+        reader_ring_free(&r->ring);
+    }
+#endif
+    if(!r->uring){
+        pthread_mutex_lock(&r->lock);
+        r->stop = 1;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+        pthread_join(r->thread, NULL);
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->cond);
+    }
+    for(i = 0; i < READER_BUFFERS; i++){
+        free(r->buffers[i]);
+    }
+    free(r);
+}
+
+/**
+ * Gets a word from a reader, splitting words exactly as getword does,
+ * including words that run across the end of a buffer.
+ * @param r the reader.
+ * @param s where the word is written.
+ * @param limit the size of s.
+ * @param hash set to the WORD_HASH of the word, unless it is NULL.
+ * @return the length of the word, or EOF at the end of the file.
+ */
+int reader_getword(reader r, char *s, int limit, unsigned int *hash){
+    return source_getword(&r->src, s, limit, hash);
+}
+
+/**
+ * Gets up to n words from a reader, so they can be processed as a batch.
+ * @param r the reader.
+ * @param words n buffers to read the words into.
+ * @param lengths set to the length of each word, unless it is NULL.
+ * @param hashes set to the hash of each word, unless it is NULL.
+ * @param n the most words to read.
+ * @param limit the size of each buffer.
+ * @return the number of words read, 0 at the end of the file.
+ */
+int reader_getwords(reader r, char **words, int *lengths,
+                    unsigned int *hashes, int n, int limit){
+    int i, length;
+    for(i = 0; i < n; i++){
+        length = source_getword(&r->src, words[i], limit,
+                                hashes == NULL ? NULL : &hashes[i]);
+        if(EOF == length){
+            break;
+        }
+        if(lengths != NULL){
+            lengths[i] = length;
+        }
+    }
+    return i;
+}
@@ -0,0 +1,15 @@
+#ifndef READER_H_
+#define READER_H_
+
+#include <stdio.h>
+
+typedef struct readerrec *reader;
+
+extern void   reader_free(reader r);
+extern int    reader_getword(reader r, char *s, int limit,
+                             unsigned int *hash);
+extern int    reader_getwords(reader r, char **words, int *lengths,
+                              unsigned int *hashes, int n, int limit);
+extern reader reader_new(FILE *stream);
+
+#endif
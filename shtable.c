@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shtable.h"
+#include "mylib.h"
+
+/* a shard doubles once more than 3/4 of its slots are full */
+#define SHTABLE_MAX_LOAD(capacity) ((capacity) / 4 * 3)
+
+/* log2 of the most shards a table can have */
+#define SHTABLE_MAX_SHARD_BITS 16
+
+/* the most slots a shard starts with, however many keys are expected,
+   so sizing a shard can never overflow */
+#define SHTABLE_MAX_SHARD_CAPACITY ((size_t)1 << 24)
+
+/**
+ * One independently sized sub-table, using linear probing.
+ * capacity is the number of slots, always a power of two.
+ * num_keys is the number of keys the shard is currently holding.
+ * *hashes stores the full hash of each key so growing never rehashes.
+ * *frequencies stores the 64 bit count of each key.
+ * **keys stores the keys, NULL if the slot is empty.
+ */
+struct shtable_shard{
+    size_t capacity;
+    size_t num_keys;
+    uint64_t *hashes;
+    uint64_t *frequencies;
+    char **keys;
+};
+
+/**
+ * A hash table split into shards.  The top bits of a key's hash pick its
+ * shard, and the low bits pick its slot in that shard, so no one array
+ * has to hold the whole vocabulary and each shard grows on its own.
+ *
+ * Shards are only allocated when their first key arrives, so a table
+ * with many shards costs nothing for the ones it never uses.
+ *
+ * shard_bits is log2 of the number of shards.
+ * shard_capacity is the size each shard starts at.
+ * *shards stores the shards.
+ */
+struct shtablerec{
+    int shard_bits;
+    size_t shard_capacity;
+    struct shtable_shard *shards;
+};
+
+/**
+ * Creates a new sharded table.
+ * @param shards the least number of shards, rounded up to a power of two
+ * and capped at 2^SHTABLE_MAX_SHARD_BITS.
+ * @param capacity how many keys the whole table is expected to hold, used
+ * to size the shards when they are first allocated, up to
+ * SHTABLE_MAX_SHARD_CAPACITY slots each.
+ * @return the created table.
+ */
+shtable shtable_new(int shards, size_t capacity){
+    int i;
+    shtable s = emalloc(sizeof *s);
+    s->shard_bits = 0;
+    while(s->shard_bits < SHTABLE_MAX_SHARD_BITS &&
+          (1 << s->shard_bits) < shards){
+        s->shard_bits++;
+    }
+    s->shard_capacity = 16;
+    while(s->shard_capacity < SHTABLE_MAX_SHARD_CAPACITY &&
+          SHTABLE_MAX_LOAD(s->shard_capacity) < capacity >> s->shard_bits){
+        s->shard_capacity *= 2;
+    }
+    s->shards = emalloc((1 << s->shard_bits) * sizeof s->shards[0]);
+    for(i = 0; i < 1 << s->shard_bits; i++){
+        s->shards[i].capacity = 0;
+        s->shards[i].num_keys = 0;
+        s->shards[i].hashes = NULL;
+        s->shards[i].frequencies = NULL;
+        s->shards[i].keys = NULL;
+    }
+    return s;
+}
+
+/**
+ * Frees all memory allocated to the table.
+ * @param s the table to be freed.
+ */
+void shtable_free(shtable s){
+    struct shtable_shard *shard;
+    size_t j;
+    int i;
+    for(i = 0; i < 1 << s->shard_bits; i++){
+        shard = &s->shards[i];
+        for(j = 0; j < shard->capacity; j++){
+            free(shard->keys[j]);
+        }
+        free(shard->hashes);
+        free(shard->frequencies);
+        free(shard->keys);
+    }
+    free(s->shards);
+    free(s);
+}
+
+/**
+ * Hashes a string with 64 bit FNV-1a, so the top bits and the low bits
+ * used for shards and slots are independent.
+ * @param str the string to be hashed.
+ * @return the hash of the string.
+ */
+static uint64_t shtable_hash(char *str){
+    uint64_t result = UINT64_C(14695981039346656037);
+    while(*str != '\0'){
+        result ^= (unsigned char)*str++;
+        result *= UINT64_C(1099511628211);
+    }
+    return result;
+}
+
+/**
+ * Finds which shard a hash belongs to.
+ * @param s the table.
+ * @param hash the hash of a key.
+ * @return the index of the shard.
+ */
+static int shtable_shard_of(shtable s, uint64_t hash){
+    return s->shard_bits == 0 ? 0 : (int)(hash >> (64 - s->shard_bits));
+}
+
+/**
+ * Allocates the arrays of a shard with every slot empty.
+ * @param shard the shard.
+ * @param capacity the number of slots, a power of two.
+ */
+static void shtable_alloc_shard(struct shtable_shard *shard, size_t capacity){
+    size_t i;
+    shard->capacity = capacity;
+    shard->hashes = emalloc(capacity * sizeof shard->hashes[0]);
+    shard->frequencies = emalloc(capacity * sizeof shard->frequencies[0]);
+    shard->keys = emalloc(capacity * sizeof shard->keys[0]);
+    for(i = 0; i < capacity; i++){
+        shard->frequencies[i] = 0;
+        shard->keys[i] = NULL;
+    }
+}
+
+/**
+ * Doubles the size of a shard, moving its keys across.
+ * @param shard the shard to grow.
+ */
+static void shtable_grow(struct shtable_shard *shard){
+    struct shtable_shard old = *shard;
+    size_t i, j, mask;
+    shtable_alloc_shard(shard, old.capacity * 2);
+    mask = shard->capacity - 1;
+    for(i = 0; i < old.capacity; i++){
+        if(old.keys[i] != NULL){
+            j = old.hashes[i] & mask;
+            while(shard->keys[j] != NULL){
+                j = (j + 1) & mask;
+            }
+            shard->hashes[j] = old.hashes[i];
+            shard->frequencies[j] = old.frequencies[i];
+            shard->keys[j] = old.keys[i];
+        }
+    }
+    free(old.hashes);
+    free(old.frequencies);
+    free(old.keys);
+}
+
+/**
+ * Finds the slot holding a key, or the empty slot it belongs in.
+ * @param shard the shard to search.
+ * @param str the key.
+ * @param hash the hash of str.
+ * @return the index of the slot.
+ */
+static size_t shtable_find(struct shtable_shard *shard, char *str,
+                           uint64_t hash){
+    size_t mask = shard->capacity - 1;
+    size_t i = hash & mask;
+    while(shard->keys[i] != NULL && (shard->hashes[i] != hash ||
+                                     strcmp(shard->keys[i], str) != 0)){
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * Inserts a string into the table, growing its shard if needed.
+ * @param s the table to be inserted into.
+ * @param str the string to be inserted.
+ * @return the frequency of the string.
+ */
+uint64_t shtable_insert(shtable s, char *str){
+    uint64_t hash = shtable_hash(str);
+    struct shtable_shard *shard = &s->shards[shtable_shard_of(s, hash)];
+    size_t i;
+    if(shard->capacity == 0){
+        shtable_alloc_shard(shard, s->shard_capacity);
+    }
+    i = shtable_find(shard, str, hash);
+    if(shard->keys[i] == NULL){
+        if(shard->num_keys + 1 > SHTABLE_MAX_LOAD(shard->capacity)){
+            shtable_grow(shard);
+            i = shtable_find(shard, str, hash);
+        }
+        shard->keys[i] = emalloc(strlen(str) + 1);
+        strcpy(shard->keys[i], str);
+        shard->hashes[i] = hash;
+        shard->num_keys++;
+    }
+    return ++shard->frequencies[i];
+}
+
+/**
+ * Searches the table for a string.
+ * @param s the table to be searched.
+ * @param str the string to be searched for.
+ * @return the number of times the string has been inserted.
+ */
+uint64_t shtable_search(shtable s, char *str){
+    uint64_t hash = shtable_hash(str);
+    struct shtable_shard *shard = &s->shards[shtable_shard_of(s, hash)];
+    if(shard->capacity == 0){
+        return 0;
+    }
+    return shard->frequencies[shtable_find(shard, str, hash)];
+}
+
+/**
+ * Counts the keys held by every shard.
+ * @param s the table.
+ * @return the number of different keys in the table.
+ */
+size_t shtable_num_keys(shtable s){
+    size_t total = 0;
+    int i;
+    for(i = 0; i < 1 << s->shard_bits; i++){
+        total += s->shards[i].num_keys;
+    }
+    return total;
+}
+
+/**
+ * Calls a function on every key in the table, shard by shard.
+ * @param s the table to be traversed.
+ * @param f a function that is passed each key and its frequency.
+ */
+void shtable_foreach(shtable s, void f(char *str, uint64_t freq)){
+    struct shtable_shard *shard;
+    size_t j;
+    int i;
+    for(i = 0; i < 1 << s->shard_bits; i++){
+        shard = &s->shards[i];
+        for(j = 0; j < shard->capacity; j++){
+            if(shard->keys[j] != NULL){
+                f(shard->keys[j], shard->frequencies[j]);
+            }
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef SHTABLE_H_
+#define SHTABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct shtablerec *shtable;
+
+extern void     shtable_foreach(shtable s, void f(char *str, uint64_t freq));
+extern void     shtable_free(shtable s);
+extern uint64_t shtable_insert(shtable s, char *str);
+extern shtable  shtable_new(int shards, size_t capacity);
+extern size_t   shtable_num_keys(shtable s);
+extern uint64_t shtable_search(shtable s, char *str);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef STRTABLE_H_
+#define STRTABLE_H_
+
+#include <string.h>
+
+#include "mylib.h"
+#include "table.h"
+
+/**
+ * Hashes a word the way htable and getword_hash do, so a hash made while
+ * reading a word can be passed to strtable_insert_hashed.
+ * @param str the word to be hashed.
+ * @return the hash of the word.
+ */
+TABLE_INLINE unsigned int strtable_hash(char *str){
+    unsigned int result = 0;
+    while(*str != '\0'){
+        result = WORD_HASH(result, *str++);
+    }
+    return result;
+}
+
+/**
+ * Copies a word into memory owned by the table.
+ * @param str the word to be copied.
+ * @return the copy.
+ */
+TABLE_INLINE char *strtable_copy(char *str){
+    return strcpy(emalloc(strlen(str) + 1), str);
+}
+
+#define STRTABLE_EQUAL(a, b) (strcmp((a), (b)) == 0)
+
+/* htable's word counts as a table family instantiation, see table.h */
+TABLE_DEFINE(strtable, char *, int, strtable_hash, STRTABLE_EQUAL,
+             strtable_copy, free)
+
+#endif
@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "suggest.h"
+#include "mylib.h"
+
+/* words longer than this are only matched exactly */
+#define SUGGEST_MAX_WORD 256
+
+/* the suggester suggest_collect adds to, the one made most recently */
+static suggest collecting = NULL;
+
+/**
+ * A spelling suggester using a symmetric deletion index (as in SymSpell).
+ * Every dictionary word is indexed under each string that can be made by
+ * deleting up to max_dist of its characters.  A lookup generates the same
+ * deletions of the unknown word, so only words sharing one of them need
+ * their edit distance checked.
+ *
+ * max_dist is the largest edit distance a suggestion may have.
+ * **words, *freqs are the dictionary words and their frequencies.
+ * *checked stores the lookup a word was last checked in.
+ * query is the serial number of the current lookup.
+ * capacity is the size of the deletion table, always a power of two.
+ * *keys stores offsets into arena of each deletion, -1 if empty.
+ * *hashes stores the hash of each deletion.
+ * *heads stores the first posting of each deletion.
+ * *post_word, *post_next form linked lists of words for each deletion.
+ * target is the word of the current lookup.
+ * *rank_word, *rank_dist hold the best found suggestions of the current
+ * lookup, rank_size of them at most.
+ */
+struct suggestrec{
+    int max_dist;
+    int num_words;
+    int words_size;
+    char **words;
+    int *freqs;
+    int *checked;
+    int query;
+    int num_keys;
+    int capacity;
+    int *keys;
+    unsigned int *hashes;
+    int *heads;
+    char *arena;
+    int arena_len;
+    int arena_size;
+    int num_posts;
+    int posts_size;
+    int *post_word;
+    int *post_next;
+    char *target;
+    int found;
+    int rank_size;
+    int *rank_word;
+    int *rank_dist;
+};
+
+/**
+ * Allocates the deletion table arrays and marks every slot empty.
+ * @param s the suggester.
+ * @param capacity the number of slots, a power of two.
+ */
+static void suggest_alloc_table(suggest s, int capacity){
+    int i;
+    s->capacity = capacity;
+    s->keys = emalloc(capacity * sizeof s->keys[0]);
+    s->hashes = emalloc(capacity * sizeof s->hashes[0]);
+    s->heads = emalloc(capacity * sizeof s->heads[0]);
+    for(i = 0; i < capacity; i++){
+        s->keys[i] = -1;
+    }
+}
+
+/**
+ * Creates a new, empty suggester.
+ * @param max_dist the largest edit distance a suggestion may have.
+ * @return the created suggester.
+ */
+suggest suggest_new(int max_dist){
+    suggest s = emalloc(sizeof *s);
+    s->max_dist = max_dist;
+    s->num_words = 0;
+    s->words_size = 1024;
+    s->words = emalloc(s->words_size * sizeof s->words[0]);
+    s->freqs = emalloc(s->words_size * sizeof s->freqs[0]);
+    s->checked = emalloc(s->words_size * sizeof s->checked[0]);
+    s->query = 0;
+    s->num_keys = 0;
+    suggest_alloc_table(s, 4096);
+    s->arena_len = 0;
+    s->arena_size = 65536;
+    s->arena = emalloc(s->arena_size);
+    s->num_posts = 0;
+    s->posts_size = 4096;
+    s->post_word = emalloc(s->posts_size * sizeof s->post_word[0]);
+    s->post_next = emalloc(s->posts_size * sizeof s->post_next[0]);
+    s->rank_size = 0;
+    s->rank_word = NULL;
+    s->rank_dist = NULL;
+    collecting = s;
+    return s;
+}
+
+/**
+ * Frees all memory allocated to the suggester.
+ * @param s the suggester to be freed.
+ */
+void suggest_free(suggest s){
+    int i;
+    for(i = 0; i < s->num_words; i++){
+        free(s->words[i]);
+    }
+    free(s->words);
+    free(s->freqs);
+    free(s->checked);
+    free(s->keys);
+    free(s->hashes);
+    free(s->heads);
+    free(s->arena);
+    free(s->post_word);
+    free(s->post_next);
+    free(s->rank_word);
+    free(s->rank_dist);
+    if(collecting == s){
+        collecting = NULL;
+    }
+    free(s);
+}
+
+/**
+ * Finds the slot holding a deletion, or the empty slot it belongs in.
+ * @param s the suggester.
+ * @param str the deletion to find.
+ * @param hash the hash of str.
+ * @return the index of the slot.
+ */
+static int suggest_find(suggest s, char *str, unsigned int hash){
+    int i = hash & (s->capacity - 1);
+    while(s->keys[i] != -1 && (s->hashes[i] != hash ||
+                               strcmp(s->arena + s->keys[i], str) != 0)){
+        i = (i + 1) & (s->capacity - 1);
+    }
+    return i;
+}
+
+/**
+ * Doubles the size of the deletion table, moving every deletion across.
+ * @param s the suggester.
+ */
+static void suggest_grow(suggest s){
+    int *keys = s->keys;
+    unsigned int *hashes = s->hashes;
+    int *heads = s->heads;
+    int capacity = s->capacity;
+    int i, j;
+    suggest_alloc_table(s, capacity * 2);
+    for(i = 0; i < capacity; i++){
+        if(keys[i] != -1){
+            j = hashes[i] & (s->capacity - 1);
+            while(s->keys[j] != -1){
+                j = (j + 1) & (s->capacity - 1);
+            }
+            s->keys[j] = keys[i];
+            s->hashes[j] = hashes[i];
+            s->heads[j] = heads[i];
+        }
+    }
+    free(keys);
+    free(hashes);
+    free(heads);
+}
+
+/**
+ * Records that a word can be reached from the given deletion.
+ * @param s the suggester.
+ * @param str the deletion.
+ * @param word the index of the dictionary word.
+ */
+static void suggest_index(suggest s, char *str, int word){
+    unsigned int hash = fnv_hash(str);
+    int len, i;
+    if(s->num_keys * 2 >= s->capacity){
+        suggest_grow(s);
+    }
+    i = suggest_find(s, str, hash);
+    if(s->keys[i] == -1){
+        len = strlen(str) + 1;
+        if(s->arena_len + len > s->arena_size){
+            while(s->arena_len + len > s->arena_size){
+                s->arena_size *= 2;
+            }
+            s->arena = erealloc(s->arena, s->arena_size);
+        }
+        memcpy(s->arena + s->arena_len, str, len);
+        s->keys[i] = s->arena_len;
+        s->hashes[i] = hash;
+        s->heads[i] = -1;
+        s->arena_len += len;
+        s->num_keys++;
+    }else if(s->heads[i] != -1 && s->post_word[s->heads[i]] == word){
+        /* the same deletion can be made from a word more than one way */
+        return;
+    }
+    if(s->num_posts == s->posts_size){
+        s->posts_size *= 2;
+        s->post_word = erealloc(s->post_word,
+                                s->posts_size * sizeof s->post_word[0]);
+        s->post_next = erealloc(s->post_next,
+                                s->posts_size * sizeof s->post_next[0]);
+    }
+    s->post_word[s->num_posts] = word;
+    s->post_next[s->num_posts] = s->heads[i];
+    s->heads[i] = s->num_posts++;
+}
+
+/**
+ * Finds the optimal string alignment distance between two strings, the
+ * number of insertions, deletions, substitutions and adjacent swaps needed
+ * to turn one into the other.  Gives up once it must exceed max.
+ * @param a the first string, shorter than SUGGEST_MAX_WORD.
+ * @param b the second string.
+ * @param max the largest distance of interest.
+ * @return the distance, or max + 1 if it is larger than max.
+ */
+static int suggest_distance(char *a, char *b, int max){
+    int rows[3][SUGGEST_MAX_WORD + 1];
+    int *prev2 = rows[0], *prev = rows[1], *cur = rows[2], *tmp;
+    int la = strlen(a), lb = strlen(b);
+    int i, j, cost, best, low;
+    if(lb >= SUGGEST_MAX_WORD || la - lb > max || lb - la > max){
+        return max + 1;
+    }
+    for(j = 0; j <= lb; j++){
+        prev[j] = j;
+    }
+    for(i = 1; i <= la; i++){
+        cur[0] = low = i;
+        for(j = 1; j <= lb; j++){
+            cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            best = prev[j - 1] + cost;
+            if(prev[j] + 1 < best){
+                best = prev[j] + 1;
+            }
+            if(cur[j - 1] + 1 < best){
+                best = cur[j - 1] + 1;
+            }
+            if(i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]
+               && prev2[j - 2] + 1 < best){
+                best = prev2[j - 2] + 1;
+            }
+            cur[j] = best;
+            if(best < low){
+                low = best;
+            }
+        }
+        if(low > max){
+            return max + 1;
+        }
+        tmp = prev2;
+        prev2 = prev;
+        prev = cur;
+        cur = tmp;
+    }
+    return prev[lb] > max ? max + 1 : prev[lb];
+}
+
+/**
+ * Calls visit on every string made by deleting 1 to max_dist - depth
+ * characters from str.
+ * @param s the suggester.
+ * @param str the string to delete characters from.
+ * @param len the length of str.
+ * @param depth how many characters have already been deleted.
+ * @param word passed through to visit.
+ * @param visit the function given each deletion.
+ */
+static void suggest_deletes(suggest s, char *str, int len, int depth, int word,
+                            void visit(suggest s, char *str, int word)){
+    char del[SUGGEST_MAX_WORD];
+    int i;
+    for(i = 0; i < len; i++){
+        memcpy(del, str, i);
+        memcpy(del + i, str + i + 1, len - i);
+        visit(s, del, word);
+        if(depth + 1 < s->max_dist){
+            suggest_deletes(s, del, len - 1, depth + 1, word, visit);
+        }
+    }
+}
+
+/**
+ * Adds a dictionary word to the suggester.  Each word should only be added
+ * once.
+ * @param s the suggester.
+ * @param str the word to be added.
+ * @param freq how common the word is, used to rank suggestions.
+ */
+void suggest_add(suggest s, char *str, int freq){
+    int len = strlen(str);
+    int word = s->num_words;
+    if(s->num_words == s->words_size){
+        s->words_size *= 2;
+        s->words = erealloc(s->words, s->words_size * sizeof s->words[0]);
+        s->freqs = erealloc(s->freqs, s->words_size * sizeof s->freqs[0]);
+        s->checked = erealloc(s->checked,
+                              s->words_size * sizeof s->checked[0]);
+    }
+    s->words[word] = emalloc(len + 1);
+    strcpy(s->words[word], str);
+    s->freqs[word] = freq;
+    s->checked[word] = 0;
+    s->num_words++;
+    suggest_index(s, str, word);
+    if(len < SUGGEST_MAX_WORD){
+        suggest_deletes(s, str, len, 0, word, suggest_index);
+    }
+}
+
+/**
+ * Decides whether one candidate should be ranked above another, closer
+ * words first, then more frequent ones, then alphabetically.
+ * @param s the suggester.
+ * @param dist_a the distance of the first candidate.
+ * @param word_a the index of the first candidate.
+ * @param dist_b the distance of the second candidate.
+ * @param word_b the index of the second candidate.
+ * @return true if the first candidate ranks above the second.
+ */
+static int suggest_better(suggest s, int dist_a, int word_a,
+                          int dist_b, int word_b){
+    if(dist_a != dist_b){
+        return dist_a < dist_b;
+    }
+    if(s->freqs[word_a] != s->freqs[word_b]){
+        return s->freqs[word_a] > s->freqs[word_b];
+    }
+    return strcmp(s->words[word_a], s->words[word_b]) < 0;
+}
+
+/**
+ * Checks every word reachable from a deletion of the target word, keeping
+ * the best rank_size of them in rank order.
+ * @param s the suggester.
+ * @param str the deletion of the target word.
+ * @param word unused, so this can be passed to suggest_deletes.
+ */
+static void suggest_check(suggest s, char *str, int word){
+    int i = suggest_find(s, str, fnv_hash(str));
+    int p, d, j;
+    if(s->keys[i] == -1){
+        return;
+    }
+    for(p = s->heads[i]; p != -1; p = s->post_next[p]){
+        word = s->post_word[p];
+        if(s->checked[word] == s->query){
+            continue;
+        }
+        s->checked[word] = s->query;
+        d = suggest_distance(s->target, s->words[word], s->max_dist);
+        if(d > s->max_dist){
+            continue;
+        }
+        j = s->found < s->rank_size ? s->found++ : s->rank_size;
+        while(j > 0 && suggest_better(s, d, word, s->rank_dist[j - 1],
+                                      s->rank_word[j - 1])){
+            if(j < s->rank_size){
+                s->rank_dist[j] = s->rank_dist[j - 1];
+                s->rank_word[j] = s->rank_word[j - 1];
+            }
+            j--;
+        }
+        if(j < s->rank_size){
+            s->rank_dist[j] = d;
+            s->rank_word[j] = word;
+        }
+    }
+}
+
+/**
+ * Adds a dictionary word to the suggester made most recently by
+ * suggest_new.  This is for passing to a table's foreach function, which
+ * has no way to pass the suggester along.
+ * @param str the word to be added.
+ * @param freq how many times the word was read.
+ */
+void suggest_collect(char *str, int freq){
+    suggest_add(collecting, str, freq);
+}
+
+/**
+ * Ranks the best dictionary words within max_dist edits of a word in
+ * rank_word, best first.
+ * @param s the suggester.
+ * @param str the word to find suggestions for.
+ * @param n the most suggestions wanted.
+ * @return how many suggestions were found.
+ */
+static int suggest_rank(suggest s, char *str, int n){
+    int len = strlen(str);
+    if(len >= SUGGEST_MAX_WORD || n <= 0){
+        return 0;
+    }
+    if(n > s->rank_size){
+        s->rank_word = erealloc(s->rank_word, n * sizeof s->rank_word[0]);
+        s->rank_dist = erealloc(s->rank_dist, n * sizeof s->rank_dist[0]);
+    }
+    s->rank_size = n;
+    s->target = str;
+    s->found = 0;
+    s->query++;
+    suggest_check(s, str, 0);
+    suggest_deletes(s, str, len, 0, 0, suggest_check);
+    return s->found;
+}
+
+/**
+ * Finds the best dictionary words within max_dist edits of a word.
+ * @param s the suggester.
+ * @param str the word to find suggestions for.
+ * @param results filled with up to n suggestions, best first.  They
+ * belong to the suggester and must not be freed.
+ * @param n the most suggestions wanted.
+ * @return how many suggestions were found.
+ */
+int suggest_lookup(suggest s, char *str, char **results, int n){
+    int found = suggest_rank(s, str, n);
+    int i;
+    for(i = 0; i < found; i++){
+        results[i] = s->words[s->rank_word[i]];
+    }
+    return found;
+}
+
+/**
+ * Prints an unknown word on a line of its own, followed by up to n
+ * suggested corrections if n is positive.
+ * @param s the suggester, only used if n is positive.
+ * @param word the unknown word.
+ * @param n the most suggestions to print.
+ * @param stream where to print.
+ */
+void suggest_print(suggest s, char *word, int n, FILE *stream){
+    int i, found;
+    fprintf(stream, "%s", word);
+    if(n > 0){
+        found = suggest_rank(s, word, n);
+        fprintf(stream, ":");
+        for(i = 0; i < found; i++){
+            fprintf(stream, " %s", s->words[s->rank_word[i]]);
+        }
+    }
+    fprintf(stream, "\n");
+}
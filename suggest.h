@@ -0,0 +1,15 @@
+#ifndef SUGGEST_H_
+#define SUGGEST_H_
+
+#include <stdio.h>
+
+typedef struct suggestrec *suggest;
+
+extern void    suggest_add(suggest s, char *str, int freq);
+extern void    suggest_collect(char *str, int freq);
+extern void    suggest_free(suggest s);
+extern int     suggest_lookup(suggest s, char *str, char **results, int n);
+extern suggest suggest_new(int max_dist);
+extern void    suggest_print(suggest s, char *word, int n, FILE *stream);
+
+#endif
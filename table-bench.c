@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mylib.h"
+#include "htable.h"
+#include "strtable.h"
+#include "table.h"
+
+/* a table counting integer IDs, with no strings at all */
+TABLE_DEFINE(idtable, unsigned int, int, TABLE_HASH_SELF, TABLE_SAME,
+             TABLE_KEY_KEEP, TABLE_KEY_DROP)
+
+/**
+ * Prints a help notice.
+ */
+static void help_notice(){
+    fprintf(stderr,"%s",
+            "Usage: ./table-bench [KEYS] [LOOKUPS]\n\n"
+
+            "Insert KEYS distinct IDs (default 1000000) twice each, then\n"
+            "time LOOKUPS random searches (default 4000000), comparing\n"
+            "htable with the strtable and idtable instantiations of the\n"
+            "table family.  htable and strtable store each ID as a word.\n");
+}
+
+/**
+ * Finds if a number is prime.
+ * @param n the number to be tested.
+ * @return true if prime false if not.
+ */
+static int is_prime(int n){
+    int i;
+    if(n < 2){
+        return 0;
+    }
+    for(i = 2; i <= n / i; i++){
+        if(n % i == 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Gives the ID numbered i, spreading consecutive numbers over the whole
+ * range of IDs.
+ * @param i the number of the ID.
+ * @return the ID.
+ */
+static unsigned int make_id(unsigned int i){
+    return i * 2654435761u;
+}
+
+/**
+ * Prints one row of results.
+ * @param name the table that was timed.
+ * @param start when filling started.
+ * @param middle when filling ended and searching started.
+ * @param end when searching ended.
+ * @param found the total frequency of the words searched for.
+ */
+static void report(char *name, clock_t start, clock_t middle, clock_t end,
+                   long found){
+    printf("%-10s %10.3f %10.3f %12ld\n", name,
+           (middle - start) / (double)CLOCKS_PER_SEC,
+           (end - middle) / (double)CLOCKS_PER_SEC, found);
+}
+
+/**
+ * Times the current string table.
+ * @param words the words to insert, 9 characters apart.
+ * @param keys the number of words to insert.
+ * @param lookups the words to search for, 9 characters apart.
+ * @param num_lookups the number of words to search for.
+ */
+static void run_htable(char *words, int keys, char *lookups,
+                       int num_lookups){
+    clock_t start, middle, end;
+    long found = 0;
+    int capacity = keys + keys / 4;
+    int i;
+    htable h;
+
+    while(!is_prime(capacity)){
+        capacity++;
+    }
+    start = clock();
+    h = htable_new(capacity, LINEAR_P);
+    for(i = 0; i < 2 * keys; i++){
+        htable_insert(h, words + 9 * (i % keys));
+    }
+    middle = clock();
+    for(i = 0; i < num_lookups; i++){
+        found += htable_search(h, lookups + 9 * i);
+    }
+    end = clock();
+    report("htable", start, middle, end, found);
+    htable_free(h);
+}
+
+/**
+ * Times the string instantiation of the table family.
+ * @param words the words to insert, 9 characters apart.
+ * @param keys the number of words to insert.
+ * @param lookups the words to search for, 9 characters apart.
+ * @param num_lookups the number of words to search for.
+ */
+static void run_strtable(char *words, int keys, char *lookups,
+                         int num_lookups){
+    clock_t start, middle, end;
+    long found = 0;
+    int *freq;
+    int i;
+    strtable t;
+
+    start = clock();
+    t = strtable_new(keys);
+    for(i = 0; i < 2 * keys; i++){
+        (*strtable_insert(t, words + 9 * (i % keys)))++;
+    }
+    middle = clock();
+    for(i = 0; i < num_lookups; i++){
+        if((freq = strtable_search(t, lookups + 9 * i)) != NULL){
+            found += *freq;
+        }
+    }
+    end = clock();
+    report("strtable", start, middle, end, found);
+    strtable_free(t);
+}
+
+/**
+ * Times the integer instantiation of the table family.
+ * @param ids the IDs to insert.
+ * @param keys the number of IDs to insert.
+ * @param lookups the IDs to search for.
+ * @param num_lookups the number of IDs to search for.
+ */
+static void run_idtable(unsigned int *ids, int keys, unsigned int *lookups,
+                        int num_lookups){
+    clock_t start, middle, end;
+    long found = 0;
+    int *freq;
+    int i;
+    idtable t;
+
+    start = clock();
+    t = idtable_new(keys);
+    for(i = 0; i < 2 * keys; i++){
+        (*idtable_insert(t, ids[i % keys]))++;
+    }
+    middle = clock();
+    for(i = 0; i < num_lookups; i++){
+        if((freq = idtable_search(t, lookups[i])) != NULL){
+            found += *freq;
+        }
+    }
+    end = clock();
+    report("idtable", start, middle, end, found);
+    idtable_free(t);
+}
+
+/**
+ * Benchmarks the current string table against instantiations of the
+ * table family.
+ * @param argc the number of arguments.
+ * @param argv the string of arguments.
+ * @return an exit-success notifier.
+ */
+int main(int argc, char **argv){
+    int keys = 1000000;
+    int num_lookups = 4000000;
+    unsigned int *ids, *id_lookups;
+    char *words, *lookups;
+    int i;
+
+    if(argc > 1 && strcmp(argv[1], "-h") == 0){
+        help_notice();
+        return EXIT_SUCCESS;
+    }
+    if(argc > 1){
+        keys = atoi(argv[1]);
+    }
+    if(argc > 2){
+        num_lookups = atoi(argv[2]);
+    }
+    if(keys <= 0 || num_lookups <= 0){
+        help_notice();
+        return EXIT_FAILURE;
+    }
+
+    ids = emalloc((size_t)keys * sizeof ids[0]);
+    words = emalloc((size_t)keys * 9);
+    for(i = 0; i < keys; i++){
+        ids[i] = make_id(i);
+        sprintf(words + 9 * i, "%08x", ids[i]);
+    }
+    /* half the lookups miss, using IDs that were never inserted */
+    id_lookups = emalloc((size_t)num_lookups * sizeof id_lookups[0]);
+    lookups = emalloc((size_t)num_lookups * 9);
+    srand(242);
+    for(i = 0; i < num_lookups; i++){
+        id_lookups[i] = make_id(rand() % (2 * keys));
+        sprintf(lookups + 9 * i, "%08x", id_lookups[i]);
+    }
+
+    printf("%d keys inserted twice, %d random lookups\n\n", keys,
+           num_lookups);
+    printf("%-10s %10s %10s %12s\n", "Table", "Fill (s)", "Search (s)",
+           "Found");
+    printf("---------------------------------------------\n");
+    run_htable(words, keys, lookups, num_lookups);
+    run_strtable(words, keys, lookups, num_lookups);
+    run_idtable(ids, keys, id_lookups, num_lookups);
+
+    free(ids);
+    free(words);
+    free(id_lookups);
+    free(lookups);
+    return EXIT_SUCCESS;
+}
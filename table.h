@@ -0,0 +1,202 @@
+#ifndef TABLE_H_
+#define TABLE_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mylib.h"
+
+/*
+ * A family of hash tables specialized at compile time.  Each use of
+ * TABLE_DEFINE writes out a complete table for one key type, value type,
+ * hash and equality, so keys and values are stored inline in the slots
+ * and every hash and comparison is inlined instead of going through a
+ * function pointer or a separate array.
+ *
+ *   TABLE_DEFINE(name, key_type, value_type, key_hash, key_equal,
+ *                key_copy, key_free)
+ *
+ * name       the name of the table type and the prefix of its functions.
+ * key_type   the key type, such as char * or unsigned int.
+ * value_type the value type, new keys start with an all zero value.
+ * key_hash   key_hash(key) gives an unsigned int hash of a key.
+ * key_equal  key_equal(a, b) is true if two keys are the same.
+ * key_copy   key_copy(key) gives the key to store when it is inserted.
+ * key_free   key_free(key) releases a stored key when the table is freed.
+ *
+ * The generated table uses linear probing over a power of two number of
+ * slots, doubling once more than 3/4 of them are full.  Slots are picked
+ * from the hash by Fibonacci hashing, so even a weak hash such as the
+ * key itself spreads well.  The full hash of each key is kept, so growing
+ * never rehashes a key and key_equal is only called when hashes match.
+ *
+ * It provides:
+ *
+ *   name        name_new(size_t capacity)
+ *   void        name_free(name t)
+ *   value_type *name_insert(name t, key_type key)
+ *   value_type *name_insert_hashed(name t, key_type key, unsigned int hash)
+ *   value_type *name_search(name t, key_type key)
+ *   value_type *name_search_hashed(name t, key_type key, unsigned int hash)
+ *   size_t      name_num_keys(name t)
+ *   void        name_foreach(name t, void f(key_type key, value_type value))
+ *
+ * insert returns where the key's value is stored, adding the key if it is
+ * new, and search returns where it is stored or NULL if it is not there.
+ * The _hashed forms take a hash already made, for example while reading
+ * the key.  A value pointer is only good until the next insert.
+ */
+
+#ifdef __GNUC__
+#define TABLE_INLINE static __inline__
+#else
+#define TABLE_INLINE static
+#endif
+
+/* set in every stored hash, so an empty slot is one with a hash of 0 */
+#define TABLE_FULL 0x80000000u
+
+/* a table grows once more than 3/4 of its slots are full */
+#define TABLE_MAX_LOAD(capacity) ((capacity) / 4 * 3)
+
+/* for keys that are compared by value and need no copying or freeing */
+#define TABLE_HASH_SELF(key) ((unsigned int)(key))
+#define TABLE_SAME(a, b) ((a) == (b))
+#define TABLE_KEY_KEEP(key) (key)
+#define TABLE_KEY_DROP(key) ((void)(key))
+
+#define TABLE_DEFINE(name, key_type, value_type, key_hash, key_equal,   \
+                     key_copy, key_free)                                \
+                                                                        \
+typedef struct name##rec *name;                                         \
+                                                                        \
+struct name##_slot{                                                     \
+    unsigned int hash;                                                  \
+    value_type value;                                                   \
+    key_type key;                                                       \
+};                                                                      \
+                                                                        \
+struct name##rec{                                                       \
+    int shift;                                                          \
+    size_t capacity;                                                    \
+    size_t num_keys;                                                    \
+    struct name##_slot *slots;                                          \
+};                                                                      \
+                                                                        \
+TABLE_INLINE void name##_alloc(name t, size_t capacity){                \
+    size_t i;                                                           \
+    t->capacity = capacity;                                             \
+    t->shift = 32;                                                      \
+    while(capacity > 1){                                                \
+        capacity /= 2;                                                  \
+        t->shift--;                                                     \
+    }                                                                   \
+    t->slots = emalloc(t->capacity * sizeof t->slots[0]);               \
+    for(i = 0; i < t->capacity; i++){                                   \
+        t->slots[i].hash = 0;                                           \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+TABLE_INLINE name name##_new(size_t capacity){                          \
+    size_t slots = 16;                                                  \
+    name t = emalloc(sizeof *t);                                        \
+    while(TABLE_MAX_LOAD(slots) < capacity){                            \
+        slots *= 2;                                                     \
+    }                                                                   \
+    name##_alloc(t, slots);                                             \
+    t->num_keys = 0;                                                    \
+    return t;                                                           \
+}                                                                       \
+                                                                        \
+TABLE_INLINE void name##_free(name t){                                  \
+    size_t i;                                                           \
+    for(i = 0; i < t->capacity; i++){                                   \
+        if(t->slots[i].hash != 0){                                      \
+            key_free(t->slots[i].key);                                  \
+        }                                                               \
+    }                                                                   \
+    free(t->slots);                                                     \
+    free(t);                                                            \
+}                                                                       \
+                                                                        \
+TABLE_INLINE size_t name##_home(name t, unsigned int h){                \
+    return (size_t)((h * 2654435769u) & 0xffffffffu) >> t->shift;       \
+}                                                                       \
+                                                                        \
+TABLE_INLINE size_t name##_find(name t, key_type key,                   \
+                                unsigned int h){                        \
+    size_t mask = t->capacity - 1;                                      \
+    size_t i = name##_home(t, h);                                       \
+    while(t->slots[i].hash != 0 &&                                      \
+          (t->slots[i].hash != h || !(key_equal(t->slots[i].key, key)))){ \
+        i = (i + 1) & mask;                                             \
+    }                                                                   \
+    return i;                                                           \
+}                                                                       \
+                                                                        \
+TABLE_INLINE void name##_grow(name t){                                  \
+    struct name##_slot *old = t->slots;                                 \
+    size_t old_capacity = t->capacity;                                  \
+    size_t i, j, mask;                                                  \
+    name##_alloc(t, old_capacity * 2);                                  \
+    mask = t->capacity - 1;                                             \
+    for(i = 0; i < old_capacity; i++){                                  \
+        if(old[i].hash != 0){                                           \
+            j = name##_home(t, old[i].hash);                            \
+            while(t->slots[j].hash != 0){                               \
+                j = (j + 1) & mask;                                     \
+            }                                                           \
+            t->slots[j] = old[i];                                       \
+        }                                                               \
+    }                                                                   \
+    free(old);                                                          \
+}                                                                       \
+                                                                        \
+TABLE_INLINE value_type *name##_insert_hashed(name t, key_type key,     \
+                                           unsigned int h){             \
+    size_t i;                                                           \
+    h |= TABLE_FULL;                                                    \
+    i = name##_find(t, key, h);                                         \
+    if(t->slots[i].hash == 0){                                          \
+        if(t->num_keys + 1 > TABLE_MAX_LOAD(t->capacity)){              \
+            name##_grow(t);                                             \
+            i = name##_find(t, key, h);                                 \
+        }                                                               \
+        t->slots[i].hash = h;                                           \
+        t->slots[i].key = key_copy(key);                                \
+        memset(&t->slots[i].value, 0, sizeof t->slots[i].value);        \
+        t->num_keys++;                                                  \
+    }                                                                   \
+    return &t->slots[i].value;                                          \
+}                                                                       \
+                                                                        \
+TABLE_INLINE value_type *name##_insert(name t, key_type key){           \
+    return name##_insert_hashed(t, key, key_hash(key));                 \
+}                                                                       \
+                                                                        \
+TABLE_INLINE value_type *name##_search_hashed(name t, key_type key,     \
+                                           unsigned int h){             \
+    size_t i = name##_find(t, key, h | TABLE_FULL);                     \
+    return t->slots[i].hash == 0 ? NULL : &t->slots[i].value;           \
+}                                                                       \
+                                                                        \
+TABLE_INLINE value_type *name##_search(name t, key_type key){           \
+    return name##_search_hashed(t, key, key_hash(key));                 \
+}                                                                       \
+                                                                        \
+TABLE_INLINE size_t name##_num_keys(name t){                            \
+    return t->num_keys;                                                 \
+}                                                                       \
+                                                                        \
+TABLE_INLINE void name##_foreach(name t,                                \
+                                 void f(key_type key,                   \
+                                        value_type value)){             \
+    size_t i;                                                           \
+    for(i = 0; i < t->capacity; i++){                                   \
+        if(t->slots[i].hash != 0){                                      \
+            f(t->slots[i].key, t->slots[i].value);                      \
+        }                                                               \
+    }                                                                   \
+}
+
+#endif
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "topk.h"
+#include "mylib.h"
+
+/**
+ * A word being tracked.
+ * count is an upper bound on how many times key has been seen.
+ * reported is what count was at the last report.
+ * hash is the hash of key.
+ */
+struct topk_entry{
+    char *key;
+    unsigned int count;
+    unsigned int reported;
+    unsigned int hash;
+};
+
+/**
+ * A SpaceSaving summary that tracks at most capacity words.  Once it is
+ * full a new word replaces the word with the lowest count, taking over
+ * that count, so frequent words stay while rare ones come and go.
+ *
+ * num_entries is the number of words being tracked.
+ * *entries stores the tracked words.
+ * *heap stores entry indices as a min-heap ordered by count.
+ * *where stores the heap position of each entry.
+ * slots is the size of the index, a power of two.
+ * *index stores entry indices by hash with linear probing, -1 if empty.
+ */
+struct topkrec{
+    int capacity;
+    int num_entries;
+    struct topk_entry *entries;
+    int *heap;
+    int *where;
+    int slots;
+    int *index;
+};
+
+/**
+ * Creates a new, empty summary.
+ * @param capacity the most words that will be tracked at once.
+ * @return the created summary.
+ */
+topk topk_new(int capacity){
+    int i;
+    topk k = emalloc(sizeof *k);
+    k->capacity = capacity;
+    k->num_entries = 0;
+    k->entries = emalloc(capacity * sizeof k->entries[0]);
+    k->heap = emalloc(capacity * sizeof k->heap[0]);
+    k->where = emalloc(capacity * sizeof k->where[0]);
+    k->slots = 1;
+    while(k->slots < 2 * capacity){
+        k->slots *= 2;
+    }
+    k->index = emalloc(k->slots * sizeof k->index[0]);
+    for(i = 0; i < k->slots; i++){
+        k->index[i] = -1;
+    }
+    return k;
+}
+
+/**
+ * Frees all memory allocated to the summary.
+ * @param k the summary to be freed.
+ */
+void topk_free(topk k){
+    int i;
+    for(i = 0; i < k->num_entries; i++){
+        free(k->entries[i].key);
+    }
+    free(k->entries);
+    free(k->heap);
+    free(k->where);
+    free(k->index);
+    free(k);
+}
+
+/**
+ * Finds the index slot holding a word, or the empty slot it belongs in.
+ * @param k the summary.
+ * @param str the word to find.
+ * @param hash the hash of str.
+ * @return the slot.
+ */
+static int topk_find(topk k, char *str, unsigned int hash){
+    int i = hash & (k->slots - 1);
+    while(k->index[i] != -1 &&
+          (k->entries[k->index[i]].hash != hash ||
+           strcmp(k->entries[k->index[i]].key, str) != 0)){
+        i = (i + 1) & (k->slots - 1);
+    }
+    return i;
+}
+
+/**
+ * Empties an index slot, shifting back any later entries that would no
+ * longer be reachable past the gap.
+ * @param k the summary.
+ * @param i the slot to empty.
+ */
+static void topk_unindex(topk k, int i){
+    int mask = k->slots - 1;
+    int j = i;
+    int home;
+    k->index[i] = -1;
+    while(1){
+        j = (j + 1) & mask;
+        if(k->index[j] == -1){
+            return;
+        }
+        home = k->entries[k->index[j]].hash & mask;
+        /* move it back unless its home lies cyclically in (i, j] */
+        if((i <= j) ? (home <= i || home > j) : (home <= i && home > j)){
+            k->index[i] = k->index[j];
+            k->index[j] = -1;
+            i = j;
+        }
+    }
+}
+
+/**
+ * Swaps two positions in the heap.
+ * @param k the summary.
+ * @param a the first position.
+ * @param b the second position.
+ */
+static void topk_swap(topk k, int a, int b){
+    int temp = k->heap[a];
+    k->heap[a] = k->heap[b];
+    k->heap[b] = temp;
+    k->where[k->heap[a]] = a;
+    k->where[k->heap[b]] = b;
+}
+
+/**
+ * Moves an entry up the heap until its parent's count is no larger.
+ * @param k the summary.
+ * @param i the heap position of the entry.
+ */
+static void topk_sift_up(topk k, int i){
+    while(i > 0 && k->entries[k->heap[i]].count <
+          k->entries[k->heap[(i - 1) / 2]].count){
+        topk_swap(k, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/**
+ * Moves an entry down the heap until its children's counts are no smaller.
+ * @param k the summary.
+ * @param i the heap position of the entry.
+ */
+static void topk_sift_down(topk k, int i){
+    int child;
+    while((child = 2 * i + 1) < k->num_entries){
+        if(child + 1 < k->num_entries &&
+           k->entries[k->heap[child + 1]].count <
+           k->entries[k->heap[child]].count){
+            child++;
+        }
+        if(k->entries[k->heap[i]].count <= k->entries[k->heap[child]].count){
+            return;
+        }
+        topk_swap(k, i, child);
+        i = child;
+    }
+}
+
+/**
+ * Counts one more occurrence of a word, tracking it if it is not already
+ * tracked.
+ * @param k the summary.
+ * @param str the word that was seen.
+ * @param limit an upper bound already known for the word's count, such as
+ * a Count-Min Sketch estimate, or 0 if none is known.  A word that replaces
+ * another is given the lower of limit and the count it takes over.
+ * @return the word's count after this occurrence.
+ */
+unsigned int topk_insert(topk k, char *str, unsigned int limit){
+    unsigned int hash = fnv_hash(str);
+    int slot = topk_find(k, str, hash);
+    struct topk_entry *e;
+    int i;
+
+    if(k->index[slot] != -1){
+        i = k->index[slot];
+        k->entries[i].count++;
+        topk_sift_down(k, k->where[i]);
+        return k->entries[i].count;
+    }
+    if(k->num_entries < k->capacity){
+        i = k->num_entries++;
+        e = &k->entries[i];
+        e->key = emalloc(strlen(str) + 1);
+        e->count = 1;
+        k->heap[i] = i;
+        k->where[i] = i;
+    }else{
+        i = k->heap[0];
+        e = &k->entries[i];
+        topk_unindex(k, topk_find(k, e->key, e->hash));
+        slot = topk_find(k, str, hash);
+        e->key = erealloc(e->key, strlen(str) + 1);
+        e->count++;
+    }
+    if(limit > 0 && limit < e->count){
+        e->count = limit;
+    }
+    strcpy(e->key, str);
+    e->reported = 0;
+    e->hash = hash;
+    k->index[slot] = i;
+    topk_sift_up(k, k->where[i]);
+    topk_sift_down(k, k->where[i]);
+    return e->count;
+}
+
+/**
+ * Orders entries by count, highest first, then alphabetically.
+ * @param a the first entry.
+ * @param b the second entry.
+ * @return negative if a comes first, positive if b comes first.
+ */
+static int topk_compare(const void *a, const void *b){
+    const struct topk_entry *x = a;
+    const struct topk_entry *y = b;
+    if(x->count != y->count){
+        return x->count > y->count ? -1 : 1;
+    }
+    return strcmp(x->key, y->key);
+}
+
+/**
+ * Prints the n words with the highest counts, each with its count and how
+ * much the count has changed since the last report.
+ * @param k the summary.
+ * @param stream the stream to print to.
+ * @param n the most words to print.
+ */
+void topk_report(topk k, FILE *stream, int n){
+    struct topk_entry *sorted;
+    int i;
+    if(k->num_entries == 0){
+        return;
+    }
+    sorted = emalloc(k->num_entries * sizeof sorted[0]);
+    memcpy(sorted, k->entries, k->num_entries * sizeof sorted[0]);
+    qsort(sorted, k->num_entries, sizeof sorted[0], topk_compare);
+    for(i = 0; i < n && i < k->num_entries; i++){
+        fprintf(stream, "%10u %+10ld   %s\n", sorted[i].count,
+                (long)sorted[i].count - (long)sorted[i].reported,
+                sorted[i].key);
+    }
+    free(sorted);
+    for(i = 0; i < k->num_entries; i++){
+        k->entries[i].reported = k->entries[i].count;
+    }
+}
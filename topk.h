@@ -0,0 +1,13 @@
+#ifndef TOPK_H_
+#define TOPK_H_
+
+#include <stdio.h>
+
+typedef struct topkrec *topk;
+
+extern void         topk_free(topk k);
+extern unsigned int topk_insert(topk k, char *str, unsigned int limit);
+extern topk         topk_new(int capacity);
+extern void         topk_report(topk k, FILE *stream, int n);
+
+#endif
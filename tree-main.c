@@ -1,38 +1,68 @@
+#define _POSIX_C_SOURCE 200809L /* for fmemopen */
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
 #include <string.h>
 #include <time.h>
+#include <ctype.h>
+#include <pthread.h>
 
 #include "mylib.h"
 #include "tree.h"
+#include "suggest.h"
+#include "reader.h"
+
+/* how many words of the -c file are looked up at once */
+#define BLOCK_WORDS 128
+
+/* the most threads -j starts, the trees they fill are merged by scanning
+   the next key of every one */
+#define MAX_THREADS 256
 
 /*Variable declarations*/
 char *spellcheck_file;
 char *dot_file;
 int spellcheck;
+int suggestions;
+suggest suggester;
 int print_depth;
 int dot;
+int bulk;
+int page_start;
+int page_count;
+int threads;
 tree_t type;
 
 /**
  * Prints a help notice when "-h" is passed as an argument.
  */
 static void help_notice() {
-    fprintf(stderr,"%s%s%s",
+    fprintf(stderr,"%s%s%s%s",
             "Usage: ./sample-tree [OPTION]... <STDIN>\n\n"
 
             "Perform various operations using a binary tree.  By default,\n"
             "words are read from stdin and added to the tree, before being\n"
             "printed out alongside their frequencies to stdout.\n\n",
 
+            " -a COUNT    Print up to COUNT suggested corrections after\n"
+            "             each unknown word (if -c is used)\n"
+            " -b          Read all words first, then build a balanced tree\n"
+            "             from them in one go\n"
             " -c FILENAME Check spelling of words in FILENAME using words\n"
             "             read from stdin as the dictionary.  Print timing\n"
             "             info & unknown words to stderr (ignore -d & -o)\n"
             " -d          Only print the tree depth (ignore -o)\n",
             " -f FILENAME Write DOT output to FILENAME (if -o given)\n"
+            " -j THREADS  Split stdin between THREADS threads, at most 256,\n"
+            "             that each fill a tree, then merge them into a\n"
+            "             balanced tree.  Fill Time is then wall clock time,\n"
+            "             not CPU time\n",
+            " -n COUNT    Only print COUNT words in order with frequencies,\n"
+            "             from position START of -s (ignore -d & -o)\n"
             " -o          Output the tree in DOT form to file 'tree-view.dot'\n"
-            " -r          Make the tree an RBT (the default is a BST)\n\n"
+            " -r          Make the tree an RBT (the default is a BST)\n"
+            " -s START    Start printing words from position START, counting\n"
+            "             from 0 (if -n given)\n\n"
 
             " -h          Print this message\n");
 }
@@ -43,11 +73,17 @@ static void help_notice() {
  * @param argv string of arguments
  */ 
 static void options(int argc, char **argv){
-    const char *optstring = "c:df:orh";
+    const char *optstring = "a:bc:df:j:n:ors:h";
     char option;
 
     while ((option = getopt(argc, argv, optstring)) != EOF) {
         switch (option) {
+            case 'a':
+                suggestions = atoi(optarg);
+                break;
+            case 'b':
+                bulk = 1;
+                break;
             case 'c':
                 spellcheck = 1;
                 spellcheck_file = optarg;
@@ -58,12 +94,24 @@ static void options(int argc, char **argv){
             case 'f':
                 dot_file = optarg;
                 break;
+            case 'j':
+                threads = atoi(optarg);
+                if(threads > MAX_THREADS){
+                    threads = MAX_THREADS;
+                }
+                break;
+            case 'n':
+                page_count = atoi(optarg);
+                break;
             case 'o':
                 dot = 1;
                 break;
             case 'r':
                 type = RBT;
                 break;
+            case 's':
+                page_start = atoi(optarg);
+                break;
             case 'h':
                 help_notice();
                 exit(EXIT_SUCCESS);
@@ -74,6 +122,148 @@ static void options(int argc, char **argv){
         }
     }
 }
+/**
+ * Reads every word from a reader and builds a tree from them with
+ * tree_build.  The words are packed into one growing buffer as they are
+ * read, rather than allocated one by one.
+ * @param r the reader to read words from.
+ * @return the built tree.
+ */
+static tree bulk_build(reader r){
+    char word[256];
+    size_t text_size = 65536, text_len = 0;
+    char *text = emalloc(text_size);
+    size_t *offsets;
+    char **words;
+    int words_size = 1024, n = 0, len, i;
+    tree t;
+
+    offsets = emalloc(words_size * sizeof offsets[0]);
+    while ((len = reader_getword(r, word, sizeof word, NULL)) != EOF){
+        while(text_len + len + 1 > text_size){
+            text_size *= 2;
+            text = erealloc(text, text_size);
+        }
+        if(n == words_size){
+            words_size *= 2;
+            offsets = erealloc(offsets, words_size * sizeof offsets[0]);
+        }
+        memcpy(text + text_len, word, len + 1);
+        offsets[n++] = text_len;
+        text_len += len + 1;
+    }
+    /* the buffer has stopped moving so offsets can become pointers */
+    words = emalloc((n > 0 ? n : 1) * sizeof words[0]);
+    for(i = 0; i < n; i++){
+        words[i] = text + offsets[i];
+    }
+    t = tree_build(words, n, type);
+    free(offsets);
+    free(words);
+    free(text);
+    return t;
+}
+
+/**
+ * One thread's share of the input for parallel_build.
+ * text is the start of the share and length is its size.
+ * t is the tree the thread fills.
+ */
+struct fill_job{
+    char *text;
+    size_t length;
+    tree t;
+};
+
+/**
+ * Fills a private tree with the words in one share of the input.
+ * @param arg the fill_job describing the share.
+ * @return NULL.
+ */
+static void *fill_share(void *arg){
+    struct fill_job *job = arg;
+    char word[256];
+    FILE *stream;
+    job->t = tree_new(type);
+    if(job->length == 0){
+        return NULL;
+    }
+    stream = fmemopen(job->text, job->length, "r");
+    if(stream == NULL){
+        perror("fmemopen");
+        exit(EXIT_FAILURE);
+    }
+    while (getword(word, sizeof word, stream) != EOF){
+        job->t = tree_insert(job->t, word);
+    }
+    fclose(stream);
+    return NULL;
+}
+
+/**
+ * Reads all of a stream, splits it into one share per thread, has each
+ * thread fill its own tree, then merges the trees with tree_merge.
+ * Shares only end between words, so every word is read whole by exactly
+ * one thread and the merged tree holds the same words and frequencies
+ * as one filled from the whole stream.
+ * @param stream the stream to read words from.
+ * @return the merged tree.
+ */
+static tree parallel_build(FILE *stream){
+    size_t size = 1 << 20, length = 0, start, end;
+    char *text = emalloc(size);
+    struct fill_job *jobs = emalloc(threads * sizeof jobs[0]);
+    pthread_t *ids = emalloc(threads * sizeof ids[0]);
+    tree *trees = emalloc(threads * sizeof trees[0]);
+    tree t;
+    int i;
+
+    while((length += fread(text + length, 1, size - length, stream)) == size){
+        size *= 2;
+        text = erealloc(text, size);
+    }
+    start = 0;
+    for(i = 0; i < threads; i++){
+        end = i == threads - 1 ? length : length / threads * (i + 1);
+        if(end < start){
+            end = start;
+        }
+        /* move the end past the rest of any word it lands in, getword
+           keeps reading a word over an apostrophe */
+        while(end < length && (isalnum((unsigned char)text[end]) ||
+                               '\'' == text[end])){
+            end++;
+        }
+        jobs[i].text = text + start;
+        jobs[i].length = end - start;
+        if(pthread_create(&ids[i], NULL, fill_share, &jobs[i]) != 0){
+            fprintf(stderr, "Could not create a thread.\n");
+            exit(EXIT_FAILURE);
+        }
+        start = end;
+    }
+    for(i = 0; i < threads; i++){
+        pthread_join(ids[i], NULL);
+        trees[i] = jobs[i].t;
+    }
+    t = tree_merge(trees, threads, type);
+    free(trees);
+    free(ids);
+    free(jobs);
+    free(text);
+    return t;
+}
+
+/**
+ * Reads the monotonic clock.
+ * @return the time in seconds from some fixed point.
+ */
+static double wall_seconds(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
 /**
  *Main file,initialises and fills tree, performs spellcheck if selected.
  * @param argc the number of arguments from terminal.
@@ -83,45 +273,93 @@ static void options(int argc, char **argv){
 int main(int argc, char **argv){
     /*Declare variables.*/
     FILE *file;
+    reader r;
     tree t;
     char word[256];
+    char block_words[BLOCK_WORDS][256];
+    char *block[BLOCK_WORDS];
+    int found[BLOCK_WORDS];
     clock_t fill_start, fill_end, search_start, search_end;
+    double wall_start, fill_time;
     int unknown_words;
+    int n, i, freq;
+    char *key;
 
     /*Set default flags and filenames.*/
     dot_file = "tree-view.dot";
     unknown_words = 0;
     spellcheck = 0;
+    suggestions = 0;
     print_depth = 0;
     dot = 0;
+    bulk = 0;
+    page_start = 0;
+    page_count = 0;
+    threads = 0;
     type = BST;
 
     options(argc, argv);
-    t = tree_new(type);
+    for(i = 0; i < BLOCK_WORDS; i++){
+        block[i] = block_words[i];
+    }
 
     fill_start = clock();
-    while (getword(word, sizeof word, stdin) != EOF){
-        t = tree_insert(t, word);
+    wall_start = wall_seconds();
+    if(threads > 0){
+        t = parallel_build(stdin);
+    }else{
+        r = reader_new(stdin);
+        if(bulk > 0){
+            t = bulk_build(r);
+        }else{
+            t = tree_new(type);
+            while (reader_getword(r, word, sizeof word, NULL) != EOF){
+                t = tree_insert(t, word);
+            }
+        }
+        reader_free(r);
     }
     fill_end = clock();
+    /* clock() adds up the CPU time of every thread, which would make a
+       parallel fill look slower than a sequential one */
+    if(threads > 0){
+        fill_time = wall_seconds() - wall_start;
+    }else{
+        fill_time = (fill_end - fill_start)/(double)CLOCKS_PER_SEC;
+    }
     set_colour(t);
 
     if(spellcheck>0){
         file = fopen(spellcheck_file,"r");
         if(file != NULL){
+            if(suggestions > 0){
+                suggester = suggest_new(2);
+                tree_foreach(t, suggest_collect);
+            }
             search_start = clock();
-            while (getword(word, sizeof word, file) != EOF) {
-                if(tree_search(t,word) == 0){
-                    printf("%s\n",word);
-                    unknown_words++;
+            r = reader_new(file);
+            while ((n = reader_getwords(r, block, NULL, NULL,
+                                        BLOCK_WORDS,
+                                        sizeof block_words[0])) > 0) {
+                tree_search_batch(t, block, n, found);
+                for(i = 0; i < n; i++){
+                    if(found[i] == 0){
+                        suggest_print(suggester, block[i], suggestions,
+                                      stdout);
+                        unknown_words++;
+                    }
                 }
             }
+            reader_free(r);
             search_end = clock();
+            if(suggestions > 0){
+                suggest_free(suggester);
+            }
             fprintf(stderr,
-                    "Fill Time:     %f\n"
+                    "Fill Time:     %f%s\n"
                     "Search time:   %f\n"
                     "Unknown words = %d\n",
-                    (fill_end - fill_start)/(double)CLOCKS_PER_SEC,
+                    fill_time, threads > 0 ? " (wall clock)" : "",
                     (search_end - search_start)/(double)CLOCKS_PER_SEC,
                     unknown_words);
         }else{
@@ -131,6 +369,18 @@ int main(int argc, char **argv){
         dot = 0;
     }
 
+    if(page_count > 0){
+        for(i = page_start; i < page_start + page_count; i++){
+            key = tree_select(t, i, &freq);
+            if(key == NULL){
+                break;
+            }
+            printf("%-4d %s\n", freq, key);
+        }
+        print_depth = 0;
+        dot = 0;
+    }
+
     if(print_depth > 0){
         printf("%d\n",tree_depth(t));
         dot = 0;
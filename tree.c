@@ -8,79 +8,144 @@
 #define IS_BLACK(x) ((NULL == (x)) || (BLACK == (x)->colour))
 #define IS_RED(x) ((NULL != (x)) && (RED == (x)->colour))
 
-static tree_t tree_type;
+/* how many searches tree_search_batch interleaves */
+#define TREE_BATCH 16
 
-static tree left_rotate(tree t);
-static tree right_rotate(tree t);
-static tree tree_fix(tree t);
+typedef struct tree_node *node_t;
 
+static node_t left_rotate(node_t t);
+static node_t right_rotate(node_t t);
+static node_t tree_fix(node_t t);
+
+/**
+ * size is the number of keys in the subtree rooted at this node.
+ * total is the sum of the frequencies in that subtree.
+ * height is the number of edges on the longest path down from this node.
+ * block is NOT_BLOCK for a node allocated on its own by tree_insert,
+ * IN_BLOCK for a node in an array allocated by tree_build, and
+ * BLOCK_START for the first node of that array, which also owns the
+ * array of keys.
+ */
 struct tree_node{
     char *key;
-    tree left;
-    tree right;
+    node_t left;
+    node_t right;
     rbt_colour colour;
     int frequency;
+    int size;
+    int total;
+    int height;
+    int block;
+};
+
+#define SIZE(x) ((NULL == (x)) ? 0 : (x)->size)
+#define TOTAL(x) ((NULL == (x)) ? 0 : (x)->total)
+#define HEIGHT(x) ((NULL == (x)) ? -1 : (x)->height)
+
+enum { NOT_BLOCK, IN_BLOCK, BLOCK_START };
+
+/**
+ * A tree of either type.  The type is fixed when the tree is made, so
+ * every insert into the tree keeps to it.  Nothing is shared between
+ * trees, so trees of either type can be used at once, even from
+ * different threads.
+ * type is either BST or RBT.
+ * *root is the root node, NULL if the tree is empty.
+ */
+struct treerec{
+    tree_t type;
+    node_t root;
 };
 
 void set_colour(tree t){
-    t->colour = BLACK;
+    if(t->root != NULL){
+        t->root->colour = BLACK;
+    }
+}
+
+/**
+ * Recalculates the size, total and height of a node from its children,
+ * which must already be up to date.
+ * @param t the node to be updated.
+ */
+static void tree_update(node_t t){
+    t->size = 1 + SIZE(t->left) + SIZE(t->right);
+    t->total = t->frequency + TOTAL(t->left) + TOTAL(t->right);
+    t->height = 1 + (HEIGHT(t->left) > HEIGHT(t->right) ?
+                     HEIGHT(t->left) : HEIGHT(t->right));
 }
 
 
 /**
- * Initilises the type of tree and returns a null pointer as an empty tree.
+ * Creates a new, empty tree.
  * @param type This is the type of tree, it can either be RBT or BST.
- * @return tree Null is returned to represent an empty tree.
+ * @return tree the created tree.
  */
 tree tree_new(tree_t type){
-    tree_type = type;
-    return NULL;
+    tree t = emalloc(sizeof *t);
+    t->type = type;
+    t->root = NULL;
+    return t;
 }
 /**
- * Inserts a string in to the right place in the respective tree.
- * @param t The tree that the string is to be added to.
+ * Inserts a string in to the right place below a node.
+ * @param t the node that the string is to be added below.
  * @param str the string that is to be added to the tree.
- * @return tree the tree with the added string.
+ * @param type the type of the tree, RBT or BST.
+ * @return the node that takes t's place.
  */
-tree tree_insert(tree t, char *str){
+static node_t tree_insert_aux(node_t t, char *str, tree_t type){
     if(t==NULL){
         t = emalloc(sizeof *t);
         t->key = emalloc((strlen(str)+1)*sizeof str[0]);
         strcpy(t->key,str);
-        t->left = tree_new(tree_type);
-        t->right = tree_new(tree_type);
+        t->left = NULL;
+        t->right = NULL;
         t->frequency = 1;
-        if(tree_type == RBT){
-            t->colour = RED;
-        }
+        t->size = 1;
+        t->total = 1;
+        t->height = 0;
+        t->block = NOT_BLOCK;
+        t->colour = type == RBT ? RED : BLACK;
     }else if(strcmp(t->key,str) == 0){
         t->frequency++;
     }else{
         if(strcmp(t->key,str) > 0){
-            t->left = tree_insert(t->left,str);
+            t->left = tree_insert_aux(t->left,str,type);
         }else if(strcmp(t->key,str) < 0){
-            t->right = tree_insert(t->right,str);
+            t->right = tree_insert_aux(t->right,str,type);
         }
     }
-    if(tree_type == RBT){
+    tree_update(t);
+    if(type == RBT){
         t = tree_fix(t);
     }
     return t;
 }
+/**
+ * Inserts a string in to the right place in the respective tree.
+ * @param t The tree that the string is to be added to.
+ * @param str the string that is to be added to the tree.
+ * @return tree the tree with the added string.
+ */
+tree tree_insert(tree t, char *str){
+    t->root = tree_insert_aux(t->root, str, t->type);
+    return t;
+}
 /**
  * A recursive preorder traversal of the tree.
  * @param t the tree to be traversed
  * @param void f(char *str) a function pointer, returns void and takes a string.
  * this is done primarily with the intenting of passing a print function.
  */
-void tree_preorder(tree t, void f(char *str)){
+static void tree_preorder_aux(node_t t, void f(char *str)){
     if(t == NULL){
         return;
     }
 
     f(t->key);
-    tree_preorder(t->left,f);
-    tree_preorder(t->right,f);
+    tree_preorder_aux(t->left,f);
+    tree_preorder_aux(t->right,f);
 }
 /**
  * A recursive preorder traversal of the tree.
@@ -88,14 +153,28 @@ void tree_preorder(tree t, void f(char *str)){
  * @param void f(char *str) a function pointer, returns void and takes a string.
  * this is done primarily with the intenting of passing a print function.
  */
-void tree_inorder(tree t, void f(char *str)){
+static void tree_inorder_aux(node_t t, void f(char *str)){
     if(t == NULL){
         return;
     }
 
-    tree_inorder(t->left,f);
+    tree_inorder_aux(t->left,f);
     f(t->key);
-    tree_inorder(t->right,f);
+    tree_inorder_aux(t->right,f);
+}
+/**
+ * A recursive inorder traversal of the tree that also passes on frequencies.
+ * @param t the tree to be traversed.
+ * @param f a function that is passed each key and its frequency.
+ */
+static void tree_foreach_aux(node_t t, void f(char *str, int freq)){
+    if(t == NULL){
+        return;
+    }
+
+    tree_foreach_aux(t->left,f);
+    f(t->key, t->frequency);
+    tree_foreach_aux(t->right,f);
 }
 /**
  * Recursively finds whether a given string is in a given tree.
@@ -103,7 +182,7 @@ void tree_inorder(tree t, void f(char *str)){
  * @param str the string that needs to be found.
  * @return 0 if not found, 1 if found.
  */
-int tree_search(tree t, char *str){
+static int tree_search_aux(node_t t, char *str){
     if(t == NULL){
         return 0;
     }
@@ -111,53 +190,311 @@ int tree_search(tree t, char *str){
     if(strcmp(t->key,str) == 0){
         return 1;
     }else if(strcmp(t->key,str) > 0){
-        return tree_search(t->left,str);
+        return tree_search_aux(t->left,str);
     }else{
-        return tree_search(t->right,str);
+        return tree_search_aux(t->right,str);
+    }
+}
+/**
+ * A recursive preorder traversal of the tree.
+ * @param t the tree to be traversed
+ * @param void f(char *str) a function pointer, returns void and takes a string.
+ */
+void tree_preorder(tree t, void f(char *str)){
+    tree_preorder_aux(t->root, f);
+}
+/**
+ * A recursive inorder traversal of the tree.
+ * @param t the tree to be traversed.
+ * @param void f(char *str) a function pointer, returns void and takes a string.
+ */
+void tree_inorder(tree t, void f(char *str)){
+    tree_inorder_aux(t->root, f);
+}
+/**
+ * A recursive inorder traversal of the tree that also passes on frequencies.
+ * @param t the tree to be traversed.
+ * @param f a function that is passed each key and its frequency.
+ */
+void tree_foreach(tree t, void f(char *str, int freq)){
+    tree_foreach_aux(t->root, f);
+}
+/**
+ * Finds whether a given string is in a given tree.
+ * @param t the tree to be searched.
+ * @param str the string that needs to be found.
+ * @return 0 if not found, 1 if found.
+ */
+int tree_search(tree t, char *str){
+    return tree_search_aux(t->root, str);
+}
+/**
+ * Finds whether each of many strings is in a tree.  Up to TREE_BATCH
+ * searches are in flight at once and take turns stepping down the tree.
+ * Each step prefetches what it needs next, a node and then its key, and
+ * the other searches do their steps while that memory arrives.  A
+ * finished search hands its place to the next string.
+ * @param t the tree to be searched.
+ * @param words the strings that need to be found.
+ * @param n the number of strings.
+ * @param results set to 1 for each string that is found, 0 if not.
+ */
+void tree_search_batch(tree t, char **words, int n, int *results){
+    node_t node[TREE_BATCH];
+    int word[TREE_BATCH];
+    int key_ready[TREE_BATCH];
+    int next = 0, active = 0;
+    int i, cmp;
+
+    for(i = 0; i < TREE_BATCH; i++){
+        node[i] = t->root;
+        word[i] = next < n ? next++ : -1;
+        key_ready[i] = 0;
+        active += word[i] >= 0;
+    }
+    while(active > 0){
+        for(i = 0; i < TREE_BATCH; i++){
+            if(word[i] < 0){
+                continue;
+            }
+            if(node[i] != NULL && !key_ready[i]){
+                PREFETCH(node[i]->key);
+                key_ready[i] = 1;
+                continue;
+            }
+            cmp = node[i] == NULL ? 0 : strcmp(node[i]->key, words[word[i]]);
+            if(node[i] == NULL || cmp == 0){
+                results[word[i]] = node[i] != NULL;
+                if(next < n){
+                    node[i] = t->root;
+                    word[i] = next++;
+                }else{
+                    word[i] = -1;
+                    active--;
+                }
+            }else{
+                node[i] = cmp > 0 ? node[i]->left : node[i]->right;
+            }
+            if(node[i] != NULL){
+                PREFETCH(node[i]);
+            }
+            key_ready[i] = 0;
+        }
+    }
+}
+
+/**
+ * Frees the nodes of a tree that were allocated on their own, and finds
+ * the start of the block of nodes made by tree_build, if there is one.
+ * The block is freed last as its nodes may be spread through the tree.
+ * @param t the tree to be freed.
+ * @param block set to the start of the block if it is found.
+ */
+static void tree_free_aux(node_t t, node_t *block){
+    if(t->left != NULL){
+        tree_free_aux(t->left, block);
+    }
+    if(t->right != NULL){
+        tree_free_aux(t->right, block);
+    }
+    if(t->block == NOT_BLOCK){
+        free(t->key);
+        free(t);
+    }else if(t->block == BLOCK_START){
+        *block = t;
     }
 }
+
 /**
  * Frees the memory allocated for a tree.
  * @param t the tree to be freed
  */
 void tree_free(tree t){
-    if(t->left != NULL){
-        tree_free(t->left);
+    node_t block = NULL;
+    if(t == NULL){
+        return;
     }
-    if(t->right != NULL){
-        tree_free(t->right);
+    if(t->root != NULL){
+        tree_free_aux(t->root, &block);
+    }
+    if(block != NULL){
+        free(block->key);
+        free(block);
     }
-    free(t->key);
     free(t);
 }
 
+/**
+ * Swaps two strings in an array.
+ * @param a the array.
+ * @param i the index of the first string.
+ * @param j the index of the second string.
+ */
+static void swap_words(char **a, int i, int j){
+    char *temp = a[i];
+    a[i] = a[j];
+    a[j] = temp;
+}
+
+/**
+ * Sorts an array of strings that all share their first d characters with
+ * multikey quicksort, which looks at each character of a string only
+ * about once instead of comparing whole strings over and over.
+ * @param a the strings to be sorted.
+ * @param n the number of strings.
+ * @param d the number of characters the strings are known to share.
+ */
+static void sort_words(char **a, int n, int d){
+    int lt, gt, i, j;
+    unsigned char pivot, c;
+    while(n > 1){
+        if(n < 8){
+            /* insertion sort is quicker for so few strings */
+            for(i = 1; i < n; i++){
+                for(j = i; j > 0 && strcmp(a[j - 1] + d, a[j] + d) > 0; j--){
+                    swap_words(a, j - 1, j);
+                }
+            }
+            return;
+        }
+        swap_words(a, 0, n / 2);
+        pivot = a[0][d];
+        lt = 0;
+        gt = n;
+        i = 1;
+        /* three way partition: [0, lt) < pivot, [lt, gt) == pivot */
+        while(i < gt){
+            c = a[i][d];
+            if(c < pivot){
+                swap_words(a, lt++, i++);
+            }else if(c > pivot){
+                swap_words(a, i, --gt);
+            }else{
+                i++;
+            }
+        }
+        sort_words(a, lt, d);
+        sort_words(a + gt, n - gt, d);
+        if(pivot == '\0'){
+            return;
+        }
+        /* the equal part shares one more character, loop instead of
+           recursing so long shared prefixes do not deepen the stack */
+        a += lt;
+        n = gt - lt;
+        d++;
+    }
+}
+
+/**
+ * Fills in the nodes of a complete tree stored in breadth first
+ * (Eytzinger) order, where the children of node i are 2i+1 and 2i+2,
+ * handing out the sorted keys by an in-order walk.
+ * @param nodes the array of nodes.
+ * @param i the node to fill in, along with its subtree.
+ * @param n the number of nodes.
+ * @param keys the sorted, distinct keys.
+ * @param freqs the frequency of each key.
+ * @param next the index of the next key to hand out, updated.
+ */
+static void build_aux(node_t nodes, int i, int n, char **keys, int *freqs,
+                      int *next){
+    if(i >= n){
+        return;
+    }
+    build_aux(nodes, 2 * i + 1, n, keys, freqs, next);
+    nodes[i].key = keys[*next];
+    nodes[i].frequency = freqs[*next];
+    (*next)++;
+    build_aux(nodes, 2 * i + 2, n, keys, freqs, next);
+}
+
+/**
+ * Builds a perfectly balanced tree from keys that are already sorted and
+ * distinct, in O(n).  The nodes live in one array in breadth first order
+ * so the top levels every search passes through share cache lines, and
+ * the keys are copied into one array in the same order.  As a complete
+ * tree it is a valid RBT when only a partly filled bottom level is red.
+ * @param keys the sorted, distinct keys, which are copied.
+ * @param freqs the frequency of each key.
+ * @param n the number of keys.
+ * @param type the type of the tree, RBT or BST.
+ * @return the built tree.
+ */
+static node_t build_sorted(char **keys, int *freqs, int n, tree_t type){
+    node_t nodes;
+    char *arena;
+    size_t total = 0;
+    int next = 0;
+    int bottom = 1;
+    int i, len;
+
+    if(n == 0){
+        return NULL;
+    }
+    nodes = emalloc(n * sizeof nodes[0]);
+    build_aux(nodes, 0, n, keys, freqs, &next);
+    for(i = 0; i < n; i++){
+        total += strlen(nodes[i].key) + 1;
+    }
+    arena = emalloc(total);
+    /* nodes from bottom - 1 on are in the bottom level, which is only
+       coloured red when it is not full */
+    while(bottom * 2 <= n){
+        bottom *= 2;
+    }
+    if(bottom * 2 - 1 == n){
+        bottom = n + 1;
+    }
+    for(i = 0; i < n; i++){
+        len = strlen(nodes[i].key) + 1;
+        memcpy(arena, nodes[i].key, len);
+        nodes[i].key = arena;
+        arena += len;
+        nodes[i].left = 2 * i + 1 < n ? &nodes[2 * i + 1] : NULL;
+        nodes[i].right = 2 * i + 2 < n ? &nodes[2 * i + 2] : NULL;
+        nodes[i].colour = (type == RBT && i + 1 >= bottom) ? RED : BLACK;
+        nodes[i].block = IN_BLOCK;
+    }
+    nodes[0].block = BLOCK_START;
+    /* children come after their parents, so work backwards */
+    for(i = n - 1; i >= 0; i--){
+        tree_update(&nodes[i]);
+    }
+    return nodes;
+}
+
 /**
  * A left rotation that preserves in-order traversal
  * @param t the tree to be rotated
  */
-static tree left_rotate(tree t){
-    tree temp = t;
+static node_t left_rotate(node_t t){
+    node_t temp = t;
     t = temp->right;
     temp->right = t->left;
     t->left = temp;
+    tree_update(temp);
+    tree_update(t);
     return t;
 }
 /**
  * A right rotation that preserves in-order traversal
  * @param t the tree to be rotated
  */
-static tree right_rotate(tree t){
-    tree temp = t;
+static node_t right_rotate(node_t t){
+    node_t temp = t;
     t = temp->left;
     temp->left = t->right;
     t->right = temp;
+    tree_update(temp);
+    tree_update(t);
     return t;
 }
 /**
  * Rearranges the nodes to maintain balance.
  * @param t the tree that needs to be rearranged.
  */
-static tree tree_fix(tree t){
+static node_t tree_fix(node_t t){
     if(IS_RED(t->left) && IS_RED(t->left->left)){
         if(IS_RED(t->right)){
             /*Case 1*/
@@ -216,23 +553,122 @@ static tree tree_fix(tree t){
     return t;
 }
 /**
- * Recursively finds the maximum depth of a tree.
+ * Finds the maximum depth of a tree, which every node keeps up to date.
  * @param the tree to be analysed for depth.
- * @return the maximum depth of a tree.
+ * @return the maximum depth of a tree, 0 if it is empty.
  */
 int tree_depth(tree t){
-    if(t->left == NULL && t->right == NULL){
-        return 0;
-    }else{
-        int leftHeight = (t->left == NULL ? 0 : tree_depth(t->left));
-        int rightHeight = (t->right == NULL ? 0 : tree_depth(t->right));
-        if(leftHeight>rightHeight){
-            return leftHeight + 1;
+    return t->root == NULL ? 0 : t->root->height;
+}
+
+/**
+ * Finds the number of different keys in a tree.
+ * @param t the tree.
+ * @return the number of keys.
+ */
+int tree_size(tree t){
+    return SIZE(t->root);
+}
+
+/**
+ * Finds the number of words inserted into a tree, counting repeats.
+ * @param t the tree.
+ * @return the sum of the frequencies of every key.
+ */
+int tree_total(tree t){
+    return TOTAL(t->root);
+}
+
+/**
+ * Counts the keys that sort before a string, and optionally the string
+ * itself, by walking one path down the tree.
+ * @param t the tree.
+ * @param str the string to compare keys with.
+ * @param inclusive true to count a key equal to str as well.
+ * @param keys set to the number of keys counted.
+ * @param total set to the sum of the frequencies of the keys counted.
+ */
+static void tree_below(node_t t, char *str, int inclusive, int *keys,
+                       int *total){
+    int cmp;
+    *keys = 0;
+    *total = 0;
+    while(t != NULL){
+        cmp = strcmp(t->key, str);
+        if(cmp > 0 || (cmp == 0 && !inclusive)){
+            t = t->left;
+        }else{
+            *keys += 1 + SIZE(t->left);
+            *total += t->frequency + TOTAL(t->left);
+            t = cmp == 0 ? NULL : t->right;
         }
-        else{
-            return rightHeight + 1;
+    }
+}
+
+/**
+ * Finds how many keys sort before a string.
+ * @param t the tree.
+ * @param str the string, which need not be in the tree.
+ * @return the number of keys less than str, which is the position str
+ * has or would have in order, counting from 0.
+ */
+int tree_rank(tree t, char *str){
+    int keys, total;
+    tree_below(t->root, str, 0, &keys, &total);
+    return keys;
+}
+
+/**
+ * Finds the key at a given position in order.
+ * @param t the tree.
+ * @param k the position of the key, counting from 0.
+ * @param freq if not NULL, set to the frequency of the key.
+ * @return the key, or NULL if k is not a position in the tree.
+ */
+char *tree_select(tree t, int k, int *freq){
+    node_t x = t->root;
+    if(k < 0){
+        return NULL;
+    }
+    while(x != NULL){
+        if(k < SIZE(x->left)){
+            x = x->left;
+        }else if(k == SIZE(x->left)){
+            if(freq != NULL){
+                *freq = x->frequency;
+            }
+            return x->key;
+        }else{
+            k -= SIZE(x->left) + 1;
+            x = x->right;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Counts the keys from lo to hi inclusive.
+ * @param t the tree.
+ * @param lo the lowest key to count.
+ * @param hi the highest key to count.
+ * @param total if not NULL, set to the sum of the frequencies of those
+ * keys.
+ * @return the number of keys from lo to hi.
+ */
+int tree_range_count(tree t, char *lo, char *hi, int *total){
+    int lo_keys, lo_total, hi_keys, hi_total;
+    if(strcmp(lo, hi) > 0){
+        if(total != NULL){
+            *total = 0;
         }
+        return 0;
+    }
+    tree_below(t->root, lo, 0, &lo_keys, &lo_total);
+    tree_below(t->root, hi, 1, &hi_keys, &hi_total);
+    if(total != NULL){
+        *total = hi_total - lo_total;
     }
+    return hi_keys - lo_keys;
 }
 
 /**
@@ -242,11 +678,11 @@ int tree_depth(tree t){
  * @param t the tree to output a DOT description of.
  * @param out the stream to write the DOT output to.
  */
-static void tree_output_dot_aux(tree t, FILE *out) {
+static void tree_output_dot_aux(node_t t, FILE *out) {
     if(t->key != NULL) {
         fprintf(out, "\"%s\"[label=\"{<f0>%s:%d|{<f1>|<f2>}}\"color=%s];\n",
                 t->key, t->key, t->frequency,
-                (RBT == tree_type && RED == t->colour) ? "red":"black");
+                RED == t->colour ? "red":"black");
     }
     if(t->left != NULL) {
         tree_output_dot_aux(t->left, out);
@@ -273,8 +709,131 @@ static void tree_output_dot_aux(tree t, FILE *out) {
 void tree_output_dot(tree t, FILE *out, char *filename) {
     printf("Creating dot file '%s'\n", filename);
     fprintf(out, "digraph tree {\nnode [shape = Mrecord, penwidth = 2];\n");
-    tree_output_dot_aux(t, out);
+    if(t->root != NULL) {
+        tree_output_dot_aux(t->root, out);
+    }
     fprintf(out, "}\n");
 }
 
+/**
+ * Builds a tree from a list of words in one go, rather than inserting
+ * them one at a time.  The words are sorted, counted and built into a
+ * perfectly balanced tree, see build_sorted.
+ * @param words the words, in any order and with repeats.  The array is
+ * sorted in place and the words are copied.
+ * @param n the number of words.
+ * @param type the type of tree, it can either be RBT or BST.
+ * @return the built tree.
+ */
+tree tree_build(char **words, int n, tree_t type){
+    char **keys;
+    int *freqs;
+    int distinct = 0;
+    int i;
+    tree t = tree_new(type);
+
+    if(n == 0){
+        return t;
+    }
+    sort_words(words, n, 0);
+    keys = emalloc(n * sizeof keys[0]);
+    freqs = emalloc(n * sizeof freqs[0]);
+    for(i = 0; i < n; i++){
+        if(distinct > 0 && strcmp(keys[distinct - 1], words[i]) == 0){
+            freqs[distinct - 1]++;
+        }else{
+            keys[distinct] = words[i];
+            freqs[distinct++] = 1;
+        }
+    }
+    t->root = build_sorted(keys, freqs, distinct, type);
+    free(keys);
+    free(freqs);
+    return t;
+}
+
+/**
+ * Copies the keys and frequencies of a tree into arrays, in order.
+ * @param t the tree to be flattened.
+ * @param keys where the keys are written.
+ * @param freqs where the frequencies are written.
+ * @param next the index of the next free place, updated.
+ */
+static void flatten(node_t t, char **keys, int *freqs, int *next){
+    if(t == NULL){
+        return;
+    }
+    flatten(t->left, keys, freqs, next);
+    keys[*next] = t->key;
+    freqs[*next] = t->frequency;
+    (*next)++;
+    flatten(t->right, keys, freqs, next);
+}
+
+/**
+ * Merges trees into one, adding up the frequencies of keys that are in
+ * more than one.  Each tree is flattened in order, the sorted lists are
+ * merged, and the result is built with build_sorted, so it is perfectly
+ * balanced and in order matches inserting every word into one tree.
+ * @param trees the trees to be merged, which are freed.
+ * @param n the number of trees.
+ * @param type the type of the merged tree, RBT or BST.
+ * @return the merged tree.
+ */
+tree tree_merge(tree *trees, int n, tree_t type){
+    char ***keys = emalloc(n * sizeof keys[0]);
+    int **freqs = emalloc(n * sizeof freqs[0]);
+    int *sizes = emalloc(n * sizeof sizes[0]);
+    int *pos = emalloc(n * sizeof pos[0]);
+    char **merged_keys;
+    int *merged_freqs;
+    int total = 0, merged = 0;
+    int i, best;
+    tree t = tree_new(type);
 
+    for(i = 0; i < n; i++){
+        sizes[i] = 0;
+        keys[i] = emalloc((SIZE(trees[i]->root) + 1) * sizeof keys[i][0]);
+        freqs[i] = emalloc((SIZE(trees[i]->root) + 1) * sizeof freqs[i][0]);
+        flatten(trees[i]->root, keys[i], freqs[i], &sizes[i]);
+        pos[i] = 0;
+        total += sizes[i];
+    }
+    merged_keys = emalloc((total + 1) * sizeof merged_keys[0]);
+    merged_freqs = emalloc((total + 1) * sizeof merged_freqs[0]);
+    while(1){
+        best = -1;
+        for(i = 0; i < n; i++){
+            if(pos[i] < sizes[i] && (best < 0 ||
+                                     strcmp(keys[i][pos[i]],
+                                            keys[best][pos[best]]) < 0)){
+                best = i;
+            }
+        }
+        if(best < 0){
+            break;
+        }
+        if(merged > 0 &&
+           strcmp(merged_keys[merged - 1], keys[best][pos[best]]) == 0){
+            merged_freqs[merged - 1] += freqs[best][pos[best]];
+        }else{
+            merged_keys[merged] = keys[best][pos[best]];
+            merged_freqs[merged++] = freqs[best][pos[best]];
+        }
+        pos[best]++;
+    }
+    t->root = build_sorted(merged_keys, merged_freqs, merged, type);
+
+    for(i = 0; i < n; i++){
+        tree_free(trees[i]);
+        free(keys[i]);
+        free(freqs[i]);
+    }
+    free(merged_keys);
+    free(merged_freqs);
+    free(keys);
+    free(freqs);
+    free(sizes);
+    free(pos);
+    return t;
+}
@@ -1,18 +1,27 @@
 #ifndef TREE_H_
 #define TREE_H_
 
-typedef struct tree_node *tree;
+typedef struct treerec *tree;
 typedef enum { RED, BLACK } rbt_colour;
 typedef enum tree_e { BST, RBT } tree_t;
 
 extern void  set_colour(tree t);
+extern tree  tree_build(char **words, int n, tree_t type);
+extern void  tree_foreach(tree t, void f(char *str, int freq));
 extern void  tree_free(tree t);
 extern void  tree_inorder(tree t, void f(char *str));
 extern tree  tree_insert(tree t, char *str);
+extern tree  tree_merge(tree *trees, int n, tree_t type);
 extern tree  tree_new(tree_t type);
 extern void  tree_preorder(tree t, void f(char *str));
 extern int   tree_search(tree t, char *str);
+extern void  tree_search_batch(tree t, char **words, int n, int *results);
 extern int tree_depth(tree t);
+extern int   tree_range_count(tree t, char *lo, char *hi, int *total);
+extern int   tree_rank(tree t, char *str);
+extern char *tree_select(tree t, int k, int *freq);
+extern int   tree_size(tree t);
+extern int   tree_total(tree t);
 extern void tree_output_dot(tree t, FILE *out, char *filename);
 
 #endif
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
+#include "mylib.h"
+#include "trie.h"
+
+/*Variable declarations*/
+char *spellcheck_file;
+char *prefix;
+int spellcheck;
+
+/**
+ * Prints a help notice when "-h" is passed as an argument.
+ */
+static void help_notice() {
+    fprintf(stderr,"%s%s%s",
+            "Usage: ./sample-trie [OPTION]... <STDIN>\n\n"
+
+            "Perform various operations using a radix trie.  By default,\n"
+            "words are read from stdin and added to the trie, before being\n"
+            "printed out in order alongside their frequencies to stdout.\n\n",
+
+            " -c FILENAME Check spelling of words in FILENAME using words\n"
+            "             read from stdin as the dictionary.  Print timing\n"
+            "             info & unknown words to stderr (ignore -p)\n",
+            " -p PREFIX   Only print the words that start with PREFIX\n\n"
+
+            " -h          Print this message\n");
+}
+
+/**
+ * Processes the commandline arguments to determine options.
+ * @param argc number of arguments
+ * @param argv string of arguments
+ */
+static void options(int argc, char **argv){
+    const char *optstring = "c:p:h";
+    char option;
+
+    while ((option = getopt(argc, argv, optstring)) != EOF) {
+        switch (option) {
+            case 'c':
+                spellcheck = 1;
+                spellcheck_file = optarg;
+                break;
+            case 'p':
+                prefix = optarg;
+                break;
+            case 'h':
+                help_notice();
+                exit(EXIT_SUCCESS);
+                break;
+            default:
+                help_notice();
+                exit(EXIT_SUCCESS);
+        }
+    }
+}
+
+/**
+ * Prints a word and its frequency.
+ * @param str the word to be printed.
+ * @param freq how many times the word was read.
+ */
+static void print_info(char *str, int freq){
+    printf("%-4d %s\n", freq, str);
+}
+
+/**
+ *Main file,initialises and fills trie, performs spellcheck if selected.
+ * @param argc the number of arguments from terminal.
+ * @param argv string of arguments.
+ * @return an exit-success notifier.
+ */
+int main(int argc, char **argv){
+    /*Declare variables.*/
+    FILE *file;
+    trie t;
+    char word[256];
+    clock_t fill_start, fill_end, search_start, search_end;
+    int unknown_words;
+
+    /*Set default flags and prefix.*/
+    prefix = "";
+    unknown_words = 0;
+    spellcheck = 0;
+
+    options(argc, argv);
+    t = trie_new();
+
+    fill_start = clock();
+    while (getword(word, sizeof word, stdin) != EOF){
+        t = trie_insert(t, word);
+    }
+    fill_end = clock();
+
+    if(spellcheck>0){
+        file = fopen(spellcheck_file,"r");
+        if(file != NULL){
+            search_start = clock();
+            while (getword(word, sizeof word, file) != EOF) {
+                if(trie_search(t,word) == 0){
+                    printf("%s\n",word);
+                    unknown_words++;
+                }
+            }
+            search_end = clock();
+            fclose(file);
+            fprintf(stderr,
+                    "Fill Time:     %f\n"
+                    "Search time:   %f\n"
+                    "Unknown words = %d\n",
+                    (fill_end - fill_start)/(double)CLOCKS_PER_SEC,
+                    (search_end - search_start)/(double)CLOCKS_PER_SEC,
+                    unknown_words);
+        }else{
+            fprintf(stderr, "The provided file could not be opened.\n");
+        }
+    }else{
+        trie_prefix(t, prefix, print_info);
+    }
+
+    trie_free(t);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trie.h"
+#include "mylib.h"
+
+/**
+ * A node of a path-compressed (radix) trie.
+ * child is the first child, children are kept sorted by the first
+ * character of their label.
+ * sibling is the next child of the same parent.
+ * frequency is how many times the word ending at this node was inserted,
+ * 0 if no word ends here.
+ * length is the number of characters in label.
+ * label holds the characters on the edge into this node, it is allocated
+ * along with the node so shared prefixes are only stored once.
+ */
+struct trie_node{
+    trie child;
+    trie sibling;
+    int frequency;
+    int length;
+    char label[1];
+};
+
+/**
+ * A growable buffer used to rebuild words while walking the trie.
+ */
+struct trie_buffer{
+    char *str;
+    int size;
+    int length;
+};
+
+/**
+ * Allocates a node holding the first len characters of label.
+ * @param label the characters on the edge into the node.
+ * @param len how many characters of label to use.
+ * @return the new node with no children and a frequency of 0.
+ */
+static trie trie_node_new(char *label, int len){
+    trie t = emalloc(sizeof *t + len);
+    memcpy(t->label, label, len);
+    t->label[len] = '\0';
+    t->length = len;
+    t->frequency = 0;
+    t->child = NULL;
+    t->sibling = NULL;
+    return t;
+}
+
+/**
+ * Returns an empty trie.
+ * @return NULL to represent an empty trie.
+ */
+trie trie_new(void){
+    return NULL;
+}
+
+/**
+ * Finds the link in a child list where a label starting with c is, or
+ * would be inserted.
+ * @param link the first link of the child list.
+ * @param c the first character of the label.
+ * @return the link pointing at the first child whose label is >= c.
+ */
+static trie *trie_find_link(trie *link, char c){
+    while(*link != NULL &&
+          (unsigned char)(*link)->label[0] < (unsigned char)c){
+        link = &(*link)->sibling;
+    }
+    return link;
+}
+
+/**
+ * Inserts a string into the trie, splitting an edge if the string
+ * leaves it part way along.
+ * @param t the trie that the string is to be added to.
+ * @param str the string that is to be added to the trie.
+ * @return the trie with the added string.
+ */
+trie trie_insert(trie t, char *str){
+    trie node, c, split;
+    trie *link;
+    int i;
+
+    if(t == NULL){
+        t = trie_node_new("", 0);
+    }
+    node = t;
+    while(*str != '\0'){
+        link = trie_find_link(&node->child, *str);
+        c = *link;
+        if(c == NULL || c->label[0] != *str){
+            c = trie_node_new(str, strlen(str));
+            c->sibling = *link;
+            *link = c;
+            node = c;
+            break;
+        }
+        for(i = 1; i < c->length && c->label[i] == str[i]; i++){
+            ;
+        }
+        if(i < c->length){
+            split = trie_node_new(c->label, i);
+            split->sibling = c->sibling;
+            split->child = c;
+            c->sibling = NULL;
+            c->length -= i;
+            memmove(c->label, c->label + i, c->length + 1);
+            *link = split;
+            c = split;
+        }
+        node = c;
+        str += i;
+    }
+    node->frequency++;
+    return t;
+}
+
+/**
+ * Finds how many times a string has been inserted into the trie.
+ * Each character of str is looked at once.
+ * @param t the trie to be searched.
+ * @param str the string that needs to be found.
+ * @return the frequency of the string, 0 if not found.
+ */
+int trie_search(trie t, char *str){
+    int i;
+    if(t == NULL){
+        return 0;
+    }
+    while(*str != '\0'){
+        t = *trie_find_link(&t->child, *str);
+        if(t == NULL){
+            return 0;
+        }
+        for(i = 0; i < t->length; i++){
+            if(t->label[i] != str[i]){
+                return 0;
+            }
+        }
+        str += t->length;
+    }
+    return t->frequency;
+}
+
+/**
+ * Appends a label to the buffer, growing it when needed.
+ * @param b the buffer to append to.
+ * @param label the characters to append.
+ * @param len how many characters of label to append.
+ */
+static void trie_buffer_append(struct trie_buffer *b, char *label, int len){
+    if(b->length + len + 1 > b->size){
+        while(b->length + len + 1 > b->size){
+            b->size *= 2;
+        }
+        b->str = erealloc(b->str, b->size);
+    }
+    memcpy(b->str + b->length, label, len);
+    b->length += len;
+    b->str[b->length] = '\0';
+}
+
+/**
+ * Calls f on every word in the trie below t, in sorted order.
+ * @param t the node that b currently spells out.
+ * @param b the buffer holding the word spelt out by the path to t.
+ * @param f a function that is passed each word and its frequency.
+ */
+static void trie_prefix_aux(trie t, struct trie_buffer *b,
+                            void f(char *str, int freq)){
+    int length = b->length;
+    if(t->frequency > 0){
+        f(b->str, t->frequency);
+    }
+    for(t = t->child; t != NULL; t = t->sibling){
+        trie_buffer_append(b, t->label, t->length);
+        trie_prefix_aux(t, b, f);
+        b->length = length;
+        b->str[length] = '\0';
+    }
+}
+
+/**
+ * Calls f, in sorted order, on every word in the trie that starts with
+ * the given prefix.  An empty prefix visits the entire trie.
+ * @param t the trie to be searched.
+ * @param prefix the start that all visited words share.
+ * @param f a function that is passed each word and its frequency.
+ */
+void trie_prefix(trie t, char *prefix, void f(char *str, int freq)){
+    struct trie_buffer b;
+    char *rest = prefix;
+    int i = 0;
+
+    if(t == NULL){
+        return;
+    }
+    while(*rest != '\0'){
+        t = *trie_find_link(&t->child, *rest);
+        if(t == NULL){
+            return;
+        }
+        for(i = 0; i < t->length && rest[i] != '\0'; i++){
+            if(t->label[i] != rest[i]){
+                return;
+            }
+        }
+        rest += i;
+    }
+    b.size = 64;
+    b.length = 0;
+    b.str = emalloc(b.size);
+    b.str[0] = '\0';
+    /* prefix may stop part way along the last edge, so rebuild the word
+       from the prefix followed by what is left of that edge */
+    trie_buffer_append(&b, prefix, rest - prefix - i);
+    trie_buffer_append(&b, t->label, t->length);
+    trie_prefix_aux(t, &b, f);
+    free(b.str);
+}
+
+/**
+ * Frees the memory allocated for a trie.
+ * @param t the trie to be freed.
+ */
+void trie_free(trie t){
+    trie next;
+    while(t != NULL){
+        next = t->sibling;
+        trie_free(t->child);
+        free(t);
+        t = next;
+    }
+}
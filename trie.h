@@ -0,0 +1,12 @@
+#ifndef TRIE_H_
+#define TRIE_H_
+
+typedef struct trie_node *trie;
+
+extern void  trie_free(trie t);
+extern trie  trie_insert(trie t, char *str);
+extern trie  trie_new(void);
+extern void  trie_prefix(trie t, char *prefix, void f(char *str, int freq));
+extern int   trie_search(trie t, char *str);
+
+#endif